@@ -21,8 +21,10 @@
 #include <atomic>
 
 // Qt
+#include <QtCore/QPointer>
 #include <QtCore/QTimer>
 #include <QQmlContext>
+#include <QQmlIncubator>
 #include <QQuickItem>
 #include <QQmlEngine>
 
@@ -36,11 +38,33 @@
 #include "private/indexmetadata_p.h"
 #include "private/viewport_p.h"
 #include "modeladapter.h"
+#include "loadingadapter.h"
 #include "private/statetracker/index_p.h"
 #include "viewbase.h"
 #include "contextadapterfactory.h"
 #include "contextadapter.h"
 
+class AbstractItemAdapterPrivate;
+
+/**
+ * Create the delegate without blocking the GUI thread.
+ *
+ * The container acts as a placeholder until the delegate is ready.
+ */
+class DelegateIncubator final : public QQmlIncubator
+{
+public:
+    explicit DelegateIncubator(AbstractItemAdapterPrivate *d) :
+        QQmlIncubator(QQmlIncubator::Asynchronous), d_ptr(d) {}
+
+protected:
+    virtual void setInitialState(QObject *o) override;
+    virtual void statusChanged(Status s) override;
+
+private:
+    AbstractItemAdapterPrivate *d_ptr;
+};
+
 class AbstractItemAdapterPrivate : public QObject
 {
     Q_OBJECT
@@ -49,9 +73,11 @@ public:
 
     // Helpers
     inline void load();
+    void initGeometry();
 
     // Actions
     bool attach ();
+    bool enterView();
     bool refresh();
     bool move   ();
     bool flush  ();
@@ -61,6 +87,7 @@ public:
     bool destroy();
     bool detach ();
     bool hide   ();
+    bool release();
 
     static const StateTracker::ViewItem::State  m_fStateMap    [7][7];
     static const StateF                 m_fStateMachine[7][7];
@@ -71,8 +98,32 @@ public:
     mutable QQuickItem  *m_pContent   {nullptr};
     mutable QQmlContext *m_pContext   {nullptr};
 
+    /// The context of the delegate itself (a child of m_pContext)
+    mutable QQmlContext       *m_pContentContext {nullptr};
+    mutable DelegateIncubator *m_pIncubator      {nullptr};
+
+    /**
+     * The adapter which was notified when the incubation started. The
+     * viewport (and its ModelAdapter) may be gone before the incubation is
+     * cancelled by the destructor.
+     */
+    mutable QPointer<LoadingAdapter> m_pLoadingAdapter;
+
+    /// The delegate is parked in the recycling pool (see ViewportSync)
+    bool m_IsPooled {false};
+
     // Helpers
     bool loadDelegate(QQuickItem* parentI) const;
+    bool createContent() const;
+    void prepareContent(QQuickItem *content) const;
+    void setContent(QQuickItem *content) const;
+    qreal placeholderHeight() const;
+    bool isSizeForced() const;
+    bool isIncubating() const;
+    void incubate() const;
+    void cancelIncubation() const;
+    void incubated(QQuickItem *content);
+    LoadingAdapter *loadingAdapter() const;
 
     // Attributes
     AbstractItemAdapter* q_ptr;
@@ -92,7 +143,7 @@ const StateTracker::ViewItem::State AbstractItemAdapterPrivate::m_fStateMap[7][7
 /*              ATTACH ENTER_BUFFER ENTER_VIEW UPDATE     MOVE   LEAVE_BUFFER   DETACH  */
 /*POOLING */ { S POOLING, S BUFFER, S ERROR , S ERROR , S ERROR , S ERROR  , S POOLED   },
 /*POOLED  */ { S POOLED , S BUFFER, S ACTIVE, S ERROR , S ERROR , S ERROR  , S DANGLING },
-/*BUFFER  */ { S ERROR  , S ERROR , S ACTIVE, S BUFFER, S ERROR , S POOLING, S DANGLING },
+/*BUFFER  */ { S ERROR  , S ERROR , S ACTIVE, S BUFFER, S ERROR , S POOLING, S POOLING  },
 /*ACTIVE  */ { S ERROR  , S BUFFER, S ERROR , S ACTIVE, S ACTIVE, S BUFFER , S POOLING  },
 /*FAILED  */ { S ERROR  , S BUFFER, S ACTIVE, S ACTIVE, S ACTIVE, S POOLED , S DANGLING },
 /*DANGLING*/ { S ERROR  , S ERROR , S ERROR , S ERROR , S ERROR , S ERROR  , S DANGLING },
@@ -102,14 +153,14 @@ const StateTracker::ViewItem::State AbstractItemAdapterPrivate::m_fStateMap[7][7
 
 #define A &AbstractItemAdapterPrivate::
 const AbstractItemAdapterPrivate::StateF AbstractItemAdapterPrivate::m_fStateMachine[7][7] = {
-/*             ATTACH  ENTER_BUFFER  ENTER_VIEW   UPDATE     MOVE   LEAVE_BUFFER  DETACH  */
-/*POOLING */ { A error  , A error  , A error  , A error  , A error  , A error  , A nothing },
-/*POOLED  */ { A nothing, A attach , A move   , A error  , A error  , A error  , A destroy },
-/*BUFFER  */ { A error  , A error  , A move   , A refresh, A error  , A detach , A destroy },
-/*ACTIVE  */ { A error  , A nothing, A nothing, A refresh, A move   , A hide   , A detach  },
-/*FAILED  */ { A error  , A nothing, A nothing, A nothing, A nothing, A nothing, A destroy },
-/*DANGLING*/ { A error  , A error  , A error  , A error  , A error  , A error  , A destroy },
-/*error   */ { A error  , A error  , A error  , A error  , A error  , A error  , A destroy },
+/*             ATTACH    ENTER_BUFFER   ENTER_VIEW    UPDATE      MOVE    LEAVE_BUFFER   DETACH  */
+/*POOLING */ { A error  , A error  , A error    , A error  , A error  , A error  , A release },
+/*POOLED  */ { A nothing, A attach , A enterView, A error  , A error  , A error  , A destroy },
+/*BUFFER  */ { A error  , A error  , A enterView, A refresh, A error  , A detach , A detach  },
+/*ACTIVE  */ { A error  , A nothing, A nothing  , A refresh, A move   , A hide   , A detach  },
+/*FAILED  */ { A error  , A nothing, A nothing  , A nothing, A nothing, A nothing, A destroy },
+/*DANGLING*/ { A error  , A error  , A error    , A error  , A error  , A error  , A destroy },
+/*error   */ { A error  , A error  , A error    , A error  , A error  , A error  , A destroy },
 };
 #undef A
 
@@ -122,6 +173,9 @@ AbstractItemAdapter::AbstractItemAdapter(Viewport* r) :
 
 AbstractItemAdapter::~AbstractItemAdapter()
 {
+    d_ptr->cancelIncubation();
+    delete d_ptr->m_pIncubator;
+
     if (d_ptr->m_pContainer)
         delete d_ptr->m_pContainer;
 
@@ -187,14 +241,44 @@ QQuickItem* StateTracker::ViewItem::item() const
     return d_ptr->container();
 }
 
+/// The delegates in the buffer exist, but stay hidden (see enterView)
 bool AbstractItemAdapterPrivate::attach()
 {
     if (m_pContainer)
-        m_pContainer->setVisible(true);
+        m_pContainer->setVisible(false);
+
+    // It comes from the pool, the delegate is already loaded, but the new
+    // index geometry isn't known yet.
+    if (m_IsPooled) {
+        m_IsPooled = false;
+
+        // The incubation was cancelled when it left the buffer, restart it.
+        // If the loading became synchronous in the meantime, create it now.
+        if (m_pContainer && m_pContentContext && !m_pContent) {
+            if (loadingAdapter()->isAsynchronous()) {
+                m_pContainer->setHeight(placeholderHeight());
+                incubate();
+            }
+            else
+                createContent();
+        }
+
+        if (m_pContainer)
+            initGeometry();
+    }
 
     return q_ptr->attach();
 }
 
+/// Leaving the buffer only has to apply the (already known) geometry
+bool AbstractItemAdapterPrivate::enterView()
+{
+    if (m_pContainer)
+        m_pContainer->setVisible(true);
+
+    return move();
+}
+
 bool AbstractItemAdapterPrivate::refresh()
 {
     return q_ptr->refresh();
@@ -220,7 +304,10 @@ bool AbstractItemAdapterPrivate::remove()
 {
     bool ret = q_ptr->remove();
 
-    m_pContainer->setParentItem(nullptr);
+    // Keep the pooled delegates in the scene (hidden), reparenting isn't free
+    if (m_pContainer && !m_IsPooled)
+        m_pContainer->setParentItem(nullptr);
+
     q_ptr->s_ptr->m_pMetadata = nullptr;
 
     return ret;
@@ -237,19 +324,34 @@ bool AbstractItemAdapterPrivate::hide()
     return true;
 }
 
-// This methodwrap the removal of the element from the view
+// This method wraps the removal of the element from the view
 bool AbstractItemAdapterPrivate::detach()
 {
-    m_pContainer->setParentItem(nullptr);
-    remove();
+    if (m_pContainer)
+        m_pContainer->setVisible(false);
+
+    // It left the buffer before the delegate was ready, there is no point in
+    // finishing it. A pooled placeholder will restart it when reused.
+    cancelIncubation();
+
+    // The context goes with the delegate, so this has to be done before the
+    // metadata is removed.
+    const auto md = q_ptr->s_ptr->m_pMetadata;
+
+    m_IsPooled = md && m_pContainer
+        && q_ptr->s_ptr->m_pViewport->s_ptr->addToPool(md, q_ptr);
 
-    //FIXME
-    q_ptr->s_ptr->m_pMetadata << IndexMetadata::ViewAction::DETACH;
-    Q_ASSERT(q_ptr->s_ptr->state() == StateTracker::ViewItem::State::POOLED);
+    remove();
 
     return true;
 }
 
+/// When the pool is full (or disabled), the delegate is destroyed
+bool AbstractItemAdapterPrivate::release()
+{
+    return m_IsPooled || destroy();
+}
+
 bool AbstractItemAdapterPrivate::nothing()
 {
     return true;
@@ -268,6 +370,8 @@ bool AbstractItemAdapterPrivate::destroy()
 {
     auto ptrCopy = m_pLocker;
 
+    cancelIncubation();
+
     //FIXME manage to add to the pool without a SEGFAULT
     if (m_pContainer) {
         m_pContainer->setParentItem(nullptr);
@@ -350,17 +454,28 @@ void AbstractItemAdapterPrivate::load()
     // QtQuick can decide to destroy it even with C++ ownership, so be it
     connect(m_pContainer, &QObject::destroyed, this, &AbstractItemAdapterPrivate::slotDestroyed);
 
+    initGeometry();
+}
+
+void AbstractItemAdapterPrivate::initGeometry()
+{
     Q_ASSERT(q_ptr->s_ptr->m_pMetadata);
 
     q_ptr->s_ptr->m_pMetadata->contextAdapter()->context();
 
     Q_ASSERT(q_ptr->s_ptr->m_pMetadata->contextAdapter()->context() == m_pContext);
 
-    if (q_ptr->s_ptr->m_pViewport->s_ptr->m_pGeoAdapter->capabilities() & GeometryAdapter::Capabilities::HAS_AHEAD_OF_TIME) {
+    const auto a = q_ptr->s_ptr->m_pViewport->s_ptr->m_pGeoAdapter;
+
+    if (a->capabilities() & GeometryAdapter::Capabilities::HAS_AHEAD_OF_TIME) {
         q_ptr->s_ptr->m_pMetadata->performAction(
             IndexMetadata::GeometryAction::MODIFY
         );
     }
+    else if ((a->capabilities() & GeometryAdapter::Capabilities::HAS_UNIFORM_HEIGHT) && !isIncubating()) {
+        // Let the strategy measure this delegate, it wont be needed again
+        q_ptr->s_ptr->m_pMetadata->setSize(a->sizeHint(q_ptr->index(), q_ptr));
+    }
     else {
         //TODO it should still call the GeometryAdapter, but most of them are
         // currently too buggy for that to help.
@@ -390,6 +505,11 @@ QQuickItem *AbstractItemAdapter::content() const
     return d_ptr->m_pContent;
 }
 
+bool AbstractItemAdapter::hasContent() const
+{
+    return d_ptr->m_pContent;
+}
+
 Viewport *AbstractItemAdapter::viewport() const
 {
     return s_ptr->m_pViewport;
@@ -492,38 +612,179 @@ bool AbstractItemAdapterPrivate::loadDelegate(QQuickItem* parentI) const
     m_pContainer = container;
 
     // Create a context with all the tree roles
-    auto ctx = new QQmlContext(pctx);
+    m_pContentContext = new QQmlContext(pctx);
 
-    // Create the delegate
-    m_pContent = qobject_cast<QQuickItem *>(delegate->create(ctx));
+    // Use a placeholder until the delegate is incubated
+    if (loadingAdapter()->isAsynchronous()) {
+        container->setHeight(placeholderHeight());
+        incubate();
+        return true;
+    }
+
+    return createContent();
+}
+
+/// Create the delegate synchronously, in the existing container
+bool AbstractItemAdapterPrivate::createContent() const
+{
+    Q_ASSERT(m_pContainer && m_pContentContext);
+
+    const auto delegate = q_ptr->s_ptr->m_pViewport->modelAdapter()->delegate();
+
+    if (!delegate)
+        return false;
+
+    auto content = qobject_cast<QQuickItem *>(delegate->create(m_pContentContext));
 
     // It allows the children to be added anyway
-    if(!m_pContent) {
+    if(!content) {
         if (!delegate->errorString().isEmpty())
             qWarning() << delegate->errorString();
 
         return true;
     }
 
-    engine->setObjectOwnership(m_pContent, QQmlEngine::CppOwnership);
+    prepareContent(content);
+    setContent(content);
 
-    m_pContent->setWidth(q_ptr->view()->width());
-    m_pContent->setParentItem(container);
+    return true;
+}
 
-    const auto a = q_ptr->s_ptr->m_pViewport->geometryAdapter();
+LoadingAdapter *AbstractItemAdapterPrivate::loadingAdapter() const
+{
+    return q_ptr->s_ptr->m_pViewport->modelAdapter()->loadingAdapter();
+}
+
+/// Apply the properties which are known before the delegate is complete
+void AbstractItemAdapterPrivate::prepareContent(QQuickItem *content) const
+{
+    const auto engine = q_ptr->s_ptr->m_pViewport->s_ptr->engine();
 
-    // Resize the container
-    if (!(a->capabilities() & GeometryAdapter::Capabilities::FORCE_DELEGATE_SIZE))
+    engine->setObjectOwnership(content, QQmlEngine::CppOwnership);
+
+    content->setWidth(q_ptr->view()->width());
+    content->setParentItem(m_pContainer);
+}
+
+void AbstractItemAdapterPrivate::setContent(QQuickItem *content) const
+{
+    Q_ASSERT(m_pContainer);
+
+    m_pContent = content;
+
+    const auto container = m_pContainer;
+
+    // Resize the container. This is a noop when the placeholder size was
+    // right, so swapping an incubated delegate doesn't move anything.
+    if (!isSizeForced())
         container->setHeight(m_pContent->height());
 
     // Make sure it can be resized dynamically
     QObject::connect(m_pContent, &QQuickItem::heightChanged, container, [container, this]() {
-        const auto a = q_ptr->s_ptr->m_pViewport->geometryAdapter();
-        if (!(a->capabilities() & GeometryAdapter::Capabilities::FORCE_DELEGATE_SIZE))
+        if (!isSizeForced())
             container->setHeight(m_pContent->height());
     });
+}
 
-    return true;
+bool AbstractItemAdapterPrivate::isSizeForced() const
+{
+    const auto a = q_ptr->s_ptr->m_pViewport->geometryAdapter();
+    return a->capabilities() & GeometryAdapter::Capabilities::FORCE_DELEGATE_SIZE;
+}
+
+/**
+ * The size of the container while the delegate is being incubated.
+ *
+ * Some strategies need the delegate to know the size. In that case, use the
+ * average height of the rows which are known.
+ */
+qreal AbstractItemAdapterPrivate::placeholderHeight() const
+{
+    const auto vp = q_ptr->s_ptr->m_pViewport;
+    const auto a  = vp->geometryAdapter();
+
+    if (a->capabilities() & GeometryAdapter::Capabilities::ALWAYS_HAS_SIZE_HINTS)
+        return a->sizeHint(q_ptr->index(), q_ptr).height();
+
+    return vp->s_ptr->m_Extents.estimatedExtent();
+}
+
+bool AbstractItemAdapterPrivate::isIncubating() const
+{
+    return m_pIncubator && m_pIncubator->isLoading();
+}
+
+void AbstractItemAdapterPrivate::incubate() const
+{
+    Q_ASSERT(m_pContentContext);
+    Q_ASSERT(!isIncubating());
+
+    const auto delegate = q_ptr->s_ptr->m_pViewport->modelAdapter()->delegate();
+
+    // The incubator is reused, the objects it created are owned by the adapter
+    if (!m_pIncubator)
+        m_pIncubator = new DelegateIncubator(const_cast<AbstractItemAdapterPrivate*>(this));
+    else
+        m_pIncubator->clear();
+
+    m_pLoadingAdapter = loadingAdapter();
+    m_pLoadingAdapter->incubationStarted();
+
+    // Note that this can complete before returning
+    delegate->create(*m_pIncubator, m_pContentContext);
+}
+
+void AbstractItemAdapterPrivate::cancelIncubation() const
+{
+    if (!isIncubating())
+        return;
+
+    // This deletes the partially created delegate
+    m_pIncubator->clear();
+
+    if (m_pLoadingAdapter)
+        m_pLoadingAdapter->incubationFinished();
+}
+
+void AbstractItemAdapterPrivate::incubated(QQuickItem *content)
+{
+    if (m_pLoadingAdapter)
+        m_pLoadingAdapter->incubationFinished();
+
+    if (!(content && m_pContainer))
+        return;
+
+    setContent(content);
+}
+
+void DelegateIncubator::setInitialState(QObject *o)
+{
+    // Do it before the bindings are evaluated, so the delegate doesn't have
+    // to be laid out twice.
+    if (auto content = qobject_cast<QQuickItem*>(o)) {
+        d_ptr->prepareContent(content);
+
+        if (d_ptr->isSizeForced())
+            content->setHeight(d_ptr->m_pContainer->height());
+    }
+}
+
+void DelegateIncubator::statusChanged(Status s)
+{
+    switch(s) {
+        case QQmlIncubator::Ready:
+            d_ptr->incubated(qobject_cast<QQuickItem*>(object()));
+            break;
+        case QQmlIncubator::Error:
+            for (const auto &e : errors())
+                qWarning() << e;
+
+            d_ptr->incubated(nullptr);
+            break;
+        case QQmlIncubator::Null:
+        case QQmlIncubator::Loading:
+            break;
+    }
 }
 
 void StateTracker::ViewItem::updateGeometry()
@@ -676,6 +937,8 @@ StateTracker::ViewItem::State StateTracker::ViewItem::state() const
 
 void AbstractItemAdapterPrivate::slotDestroyed()
 {
+    cancelIncubation();
+
     m_pContainer = nullptr;
     m_pContent   = nullptr;
 }
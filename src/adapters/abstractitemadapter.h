@@ -101,6 +101,14 @@ public:
      */
     virtual QQuickItem *content() const;
 
+    /**
+     * If the delegate instance exists.
+     *
+     * Unlike content(), this doesn't load it. It is false while the
+     * container is only a placeholder (see LoadingAdapter).
+     */
+    bool hasContent() const;
+
     Viewport *viewport() const;
 
     /**
@@ -0,0 +1,70 @@
+/***************************************************************************
+ *   Copyright (C) 2018-2019 by Emmanuel Lepage Vallee                     *
+ *   Author : Emmanuel Lepage Vallee <emmanuel.lepage@kde.org>             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+#include "loadingadapter.h"
+
+class LoadingAdapterPrivate
+{
+public:
+    bool m_IsAsynchronous  {false};
+    int  m_IncubatingCount {  0  };
+};
+
+LoadingAdapter::LoadingAdapter(QObject *parent) : QObject(parent),
+    d_ptr(new LoadingAdapterPrivate)
+{}
+
+LoadingAdapter::~LoadingAdapter()
+{
+    delete d_ptr;
+}
+
+bool LoadingAdapter::isAsynchronous() const
+{
+    return d_ptr->m_IsAsynchronous;
+}
+
+/**
+ * Only the delegates loaded after this is changed are affected, the existing
+ * ones are kept as-is.
+ */
+void LoadingAdapter::setAsynchronous(bool value)
+{
+    if (d_ptr->m_IsAsynchronous == value)
+        return;
+
+    d_ptr->m_IsAsynchronous = value;
+
+    Q_EMIT asynchronousChanged(value);
+}
+
+int LoadingAdapter::incubatingCount() const
+{
+    return d_ptr->m_IncubatingCount;
+}
+
+void LoadingAdapter::incubationStarted()
+{
+    Q_EMIT incubatingCountChanged(++d_ptr->m_IncubatingCount);
+}
+
+void LoadingAdapter::incubationFinished()
+{
+    Q_ASSERT(d_ptr->m_IncubatingCount > 0);
+
+    Q_EMIT incubatingCountChanged(--d_ptr->m_IncubatingCount);
+}
@@ -18,19 +18,59 @@
 #ifndef LOADING_ADAPTER_H
 #define LOADING_ADAPTER_H
 
-#include <QtCore/QWidget>
+// Qt
+#include <QtCore/QObject>
+
+class LoadingAdapterPrivate;
 
 /**
- * This adapter helps to define strategies to choose which delegates to load
- * next. This can depend on the view type (for example a list ignoring all
- * children QModelIndex) or zoom level (for example, in a GIS view).
+ * This adapter controls how the delegates are instantiated.
+ *
+ * By default, the delegates are created synchronously when a row enters the
+ * buffer. For complex delegates, this can block the GUI thread for many frames
+ * when the view scrolls quickly.
+ *
+ * When `asynchronous` is set, the delegates are incubated by the QML engine
+ * (using the QQuickWindow incubation controller). The container is created
+ * immediately and sized by the GeometryAdapter (or using the average row
+ * height when the strategy needs the delegate to know the size). When the
+ * incubation completes, the delegate is swapped in. If the row leaves the
+ * buffer before this happens, the incubation is cancelled.
+ *
+ * In the future, this adapter could also help to define strategies to choose
+ * which delegates to load next. This can depend on the view type (for example
+ * a list ignoring all children QModelIndex) or zoom level (for example, in a
+ * GIS view).
  */
 class Q_DECL_EXPORT LoadingAdapter : public QObject
 {
     Q_OBJECT
+    friend class AbstractItemAdapterPrivate; // Report the incubation progress
 public:
+    /// Incubate the delegates instead of creating them synchronously
+    Q_PROPERTY(bool asynchronous READ isAsynchronous WRITE setAsynchronous NOTIFY asynchronousChanged)
+
+    /// The number of delegates currently being incubated
+    Q_PROPERTY(int incubatingCount READ incubatingCount NOTIFY incubatingCountChanged)
+
     explicit LoadingAdapter(QObject *parent = nullptr);
     virtual ~LoadingAdapter();
+
+    bool isAsynchronous() const;
+    void setAsynchronous(bool value);
+
+    int incubatingCount() const;
+
+Q_SIGNALS:
+    void asynchronousChanged(bool value);
+    void incubatingCountChanged(int count);
+
+private:
+    void incubationStarted();
+    void incubationFinished();
+
+    LoadingAdapterPrivate *d_ptr;
+    Q_DECLARE_PRIVATE(LoadingAdapter)
 };
 
 #endif
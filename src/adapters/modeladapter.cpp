@@ -27,6 +27,7 @@
 #include "viewport.h"
 #include "viewbase.h"
 #include "selectionadapter.h"
+#include "loadingadapter.h"
 #include "contextadapterfactory.h"
 #include "private/selectionadapter_p.h"
 #include "private/statetracker/viewitem_p.h"
@@ -53,6 +54,7 @@ public:
     QQmlComponent          *m_pDelegate           {nullptr};
     Viewport               *m_pViewport           {nullptr};
     SelectionAdapter       *m_pSelectionManager   {nullptr};
+    LoadingAdapter         *m_pLoadingAdapter     {nullptr};
     ViewBase               *m_pView               {nullptr};
     ContextAdapterFactory  *m_pRoleContextFactory {nullptr};
 
@@ -61,6 +63,9 @@ public:
     int  m_MaxDepth    { -1  };
     int  m_CacheBuffer { 10  };
     int  m_PoolSize    { 10  };
+    int  m_LoadBudget  {  0  };
+
+    qreal m_CacheBufferHeight { 0.0 };
 
     int m_ExpandedCount { 999 }; //TODO
 
@@ -68,6 +73,10 @@ public:
         ModelAdapter::RecyclingMode::NoRecycling
     };
 
+    ModelAdapter::IndexTrackingMode m_IndexTrackingMode {
+        ModelAdapter::IndexTrackingMode::PersistentIndices
+    };
+
     // Helpers
     void setModelCommon(QAbstractItemModel* m, QAbstractItemModel* old);
 
@@ -85,6 +94,7 @@ ModelAdapter::ModelAdapter(ViewBase* parent) : QObject(parent),
     d_ptr->q_ptr = this;
     d_ptr->m_pView = parent;
     d_ptr->m_pSelectionManager = new SelectionAdapter(this);
+    d_ptr->m_pLoadingAdapter   = new LoadingAdapter  (this);
 
     selectionAdapter()->s_ptr->setView(parent);
     contextAdapterFactory()->addContextExtension(selectionAdapter()->contextExtension());
@@ -253,7 +263,17 @@ int ModelAdapter::cacheBuffer() const
 
 void ModelAdapter::setCacheBuffer(int value)
 {
-    d_ptr->m_CacheBuffer = std::min(1, value);
+    d_ptr->m_CacheBuffer = std::max(0, value);
+}
+
+qreal ModelAdapter::cacheBufferHeight() const
+{
+    return d_ptr->m_CacheBufferHeight;
+}
+
+void ModelAdapter::setCacheBufferHeight(qreal value)
+{
+    d_ptr->m_CacheBufferHeight = std::max(0.0, value);
 }
 
 int ModelAdapter::poolSize() const
@@ -263,7 +283,27 @@ int ModelAdapter::poolSize() const
 
 void ModelAdapter::setPoolSize(int value)
 {
-    d_ptr->m_PoolSize = value;
+    d_ptr->m_PoolSize = std::max(0, value);
+}
+
+int ModelAdapter::poolHits() const
+{
+    return d_ptr->m_pViewport->s_ptr->m_PoolHits;
+}
+
+int ModelAdapter::poolMisses() const
+{
+    return d_ptr->m_pViewport->s_ptr->m_PoolMisses;
+}
+
+int ModelAdapter::loadingBudget() const
+{
+    return d_ptr->m_LoadBudget;
+}
+
+void ModelAdapter::setLoadingBudget(int ms)
+{
+    d_ptr->m_LoadBudget = std::max(0, ms);
 }
 
 ModelAdapter::RecyclingMode ModelAdapter::recyclingMode() const
@@ -273,9 +313,26 @@ ModelAdapter::RecyclingMode ModelAdapter::recyclingMode() const
 
 void ModelAdapter::setRecyclingMode(ModelAdapter::RecyclingMode mode)
 {
+    if (mode == d_ptr->m_RecyclingMode)
+        return;
+
+    // The pools are not split the same way
+    d_ptr->m_pViewport->s_ptr->clearPool();
+
     d_ptr->m_RecyclingMode = mode;
 }
 
+ModelAdapter::IndexTrackingMode ModelAdapter::indexTrackingMode() const
+{
+    return d_ptr->m_IndexTrackingMode;
+}
+
+/// This only affects the elements changing state after it is set
+void ModelAdapter::setIndexTrackingMode(ModelAdapter::IndexTrackingMode mode)
+{
+    d_ptr->m_IndexTrackingMode = mode;
+}
+
 void ModelAdapter::setSelectionAdapter(SelectionAdapter* v)
 {
     d_ptr->m_pSelectionManager = v;
@@ -286,6 +343,11 @@ SelectionAdapter* ModelAdapter::selectionAdapter() const
     return d_ptr->m_pSelectionManager;
 }
 
+LoadingAdapter* ModelAdapter::loadingAdapter() const
+{
+    return d_ptr->m_pLoadingAdapter;
+}
+
 ContextAdapterFactory* ModelAdapter::contextAdapterFactory() const
 {
     if (!d_ptr->m_pRoleContextFactory) {
@@ -22,6 +22,7 @@
 
 // KQuickItemViews
 class SelectionAdapter;
+class LoadingAdapter;
 class ContextAdapterFactory;
 class Viewport;
 class ViewBase;
@@ -60,8 +61,20 @@ public:
     Q_PROPERTY(RecyclingMode recyclingMode READ recyclingMode WRITE setRecyclingMode)
     /// The number of elements to be preloaded outside of the visible area (for latency)
     Q_PROPERTY(int cacheBuffer READ cacheBuffer WRITE setCacheBuffer)
+    /// The height (in pixels) preloaded above and below the visible area, on top of cacheBuffer
+    Q_PROPERTY(qreal cacheBufferHeight READ cacheBufferHeight WRITE setCacheBufferHeight)
     /// The number of delegates to be kept in a recycling pool (for performance)
     Q_PROPERTY(int poolSize READ poolSize WRITE setPoolSize)
+    /// The time (in ms) spent creating delegates per frame, 0 for no limit (for latency)
+    Q_PROPERTY(int loadingBudget READ loadingBudget WRITE setLoadingBudget)
+    /// How the delegates are created (synchronously or incubated)
+    Q_PROPERTY(LoadingAdapter* loadingAdapter READ loadingAdapter CONSTANT)
+    /// The number of delegates which were reused from the pool (to tune poolSize)
+    Q_PROPERTY(int poolHits READ poolHits NOTIFY poolStatsChanged)
+    /// The number of delegates created because the pool was empty
+    Q_PROPERTY(int poolMisses READ poolMisses NOTIFY poolStatsChanged)
+    /// Which loaded elements are tracked using a QPersistentModelIndex (for performance)
+    Q_PROPERTY(IndexTrackingMode indexTrackingMode READ indexTrackingMode WRITE setIndexTrackingMode)
 
     enum RecyclingMode {
         NoRecycling    , /*!< Destroy and create new QQuickItems all the time         */
@@ -70,6 +83,12 @@ public:
     };
     Q_ENUM(RecyclingMode)
 
+    enum IndexTrackingMode {
+        PersistentIndices , /*!< All loaded elements have a QPersistentModelIndex   */
+        LightweightIndices, /*!< Only the VISIBLE and BUFFER elements have one      */
+    };
+    Q_ENUM(IndexTrackingMode)
+
     explicit ModelAdapter(ViewBase *parent = nullptr);
     virtual ~ModelAdapter();
 
@@ -91,18 +110,31 @@ public:
     int cacheBuffer() const;
     void setCacheBuffer(int value);
 
+    qreal cacheBufferHeight() const;
+    void setCacheBufferHeight(qreal value);
+
     int poolSize() const;
     void setPoolSize(int value);
 
+    int poolHits() const;
+    int poolMisses() const;
+
+    int loadingBudget() const;
+    void setLoadingBudget(int ms);
+
     RecyclingMode recyclingMode() const;
     void setRecyclingMode(RecyclingMode mode);
 
+    IndexTrackingMode indexTrackingMode() const;
+    void setIndexTrackingMode(IndexTrackingMode mode);
+
     bool isEmpty() const;
 
     bool isCollapsed() const;
 
     SelectionAdapter* selectionAdapter() const;
     ContextAdapterFactory* contextAdapterFactory() const;
+    LoadingAdapter* loadingAdapter() const;
 
     QVector<Viewport*> viewports() const;
 
@@ -121,6 +153,7 @@ Q_SIGNALS:
     void delegateChanged(QQmlComponent* delegate);
     void contentChanged();
     void collapsedChanged();
+    void poolStatsChanged();
 
 private:
     ModelAdapterPrivate *d_ptr;
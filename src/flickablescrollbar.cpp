@@ -19,6 +19,11 @@
 
 // KQuickItemViews
 #include "views/flickable.h"
+#include "viewbase.h"
+#include "viewport.h"
+#include "adapters/modeladapter.h"
+#include "private/viewport_p.h"
+#include "private/geostrategyselector_p.h"
 
 class FlickableScrollBarPrivate : public QObject
 {
@@ -31,6 +36,8 @@ public:
 
     FlickableScrollBar* q_ptr;
 
+    void setHasScrollbar(bool value);
+
 public Q_SLOTS:
     void recomputeGeometry();
 };
@@ -54,10 +61,14 @@ QObject* FlickableScrollBar::view() const
 void FlickableScrollBar::setView(QObject* v)
 {
     if (d_ptr->m_pView) {
+        d_ptr->setHasScrollbar(false);
+
         disconnect(d_ptr->m_pView, &Flickable::contentHeightChanged,
             d_ptr, &FlickableScrollBarPrivate::recomputeGeometry);
         disconnect(d_ptr->m_pView, &Flickable::contentYChanged,
             d_ptr, &FlickableScrollBarPrivate::recomputeGeometry);
+        disconnect(d_ptr->m_pView, &Flickable::originYChanged,
+            d_ptr, &FlickableScrollBarPrivate::recomputeGeometry);
         disconnect(d_ptr->m_pView, &Flickable::heightChanged,
             d_ptr, &FlickableScrollBarPrivate::recomputeGeometry);
     }
@@ -66,10 +77,14 @@ void FlickableScrollBar::setView(QObject* v)
 
     Q_ASSERT((!v) || d_ptr->m_pView);
 
+    d_ptr->setHasScrollbar(true);
+
     connect(d_ptr->m_pView, &Flickable::contentHeightChanged,
         d_ptr, &FlickableScrollBarPrivate::recomputeGeometry);
     connect(d_ptr->m_pView, &Flickable::contentYChanged,
         d_ptr, &FlickableScrollBarPrivate::recomputeGeometry);
+    connect(d_ptr->m_pView, &Flickable::originYChanged,
+        d_ptr, &FlickableScrollBarPrivate::recomputeGeometry);
     connect(d_ptr->m_pView, &Flickable::heightChanged,
         d_ptr, &FlickableScrollBarPrivate::recomputeGeometry);
 
@@ -87,7 +102,7 @@ void FlickableScrollBar::setPosition(qreal p)
         return;
 
     // Simple rule of 3
-    d_ptr->m_pView->setContentY(
+    d_ptr->m_pView->setContentY(d_ptr->m_pView->originY() +
         (p * d_ptr->m_pView->contentHeight()) / d_ptr->m_pView->height()
     );
 }
@@ -102,6 +117,27 @@ bool FlickableScrollBar::isHandleVisible() const
     return d_ptr->m_Visible;
 }
 
+/**
+ * The handle size and position need the height of the rows which are not
+ * loaded yet, let the geometry strategy selector know it has to provide them.
+ */
+void FlickableScrollBarPrivate::setHasScrollbar(bool value)
+{
+    auto v = qobject_cast<ViewBase*>(m_pView);
+
+    if (!v)
+        return;
+
+    const auto adapters = v->modelAdapters();
+
+    for (auto a : adapters) {
+        const auto viewports = a->viewports();
+
+        for (auto vp : viewports)
+            vp->s_ptr->m_pGeoAdapter->setHasScrollbar(value);
+    }
+}
+
 /**
  * The idea behind the scrollhandle is that the height represent the height of a
  * page until it gets too small. In mobile mode, the height is always the same
@@ -119,7 +155,7 @@ void FlickableScrollBarPrivate::recomputeGeometry()
     const qreal pageHeight   = m_pView->height();
     const qreal pageCount    = totalHeight/pageHeight;
     const qreal handleHeight = std::max(pageHeight/pageCount, 50.0);
-    const qreal handleBegin  = (m_pView->contentY()*pageHeight)/totalHeight;
+    const qreal handleBegin  = ((m_pView->contentY() - m_pView->originY())*pageHeight)/totalHeight;
 
     m_HandleHeight = handleHeight;
     m_Position     = handleBegin;
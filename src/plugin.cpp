@@ -38,6 +38,8 @@
 // Strategies
 #include "strategies/justintime.h"
 #include "strategies/role.h"
+#include "strategies/aheadoftime.h"
+#include "strategies/delegate.h"
 #include "strategies/proxy.h"
 
 
@@ -65,6 +67,8 @@ void KQuickItemViews::registerTypes(const char *uri)
     auto suri = QString(QString(uri) + QString(".Strategies")).toLatin1();
     qmlRegisterType<GeometryStrategies::JustInTime>(suri, 1, 0, "JustInTime");
     qmlRegisterType<GeometryStrategies::Role>(suri, 1, 0, "Role");
+    qmlRegisterType<GeometryStrategies::AheadOfTime>(suri, 1, 0, "AheadOfTime");
+    qmlRegisterType<GeometryStrategies::Delegate>(suri, 1, 0, "Delegate");
 
     // Alias
     qmlRegisterUncreatableType<QModelIndexBinder>(
@@ -0,0 +1,111 @@
+/***************************************************************************
+ *   Copyright (C) 2019 by Emmanuel Lepage Vallee                          *
+ *   Author : Emmanuel Lepage Vallee <emmanuel.lepage@kde.org>             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+#include "delegatemeasurer_p.h"
+
+// Qt
+#include <QtCore/QDebug>
+#include <QQmlComponent>
+#include <QQmlContext>
+#include <QQmlEngine>
+#include <QQuickItem>
+
+// KQuickItemViews
+#include <viewport.h>
+#include <viewbase.h>
+#include <contextadapterfactory.h>
+#include <adapters/contextadapter.h>
+#include <adapters/modeladapter.h>
+#include <private/viewport_p.h>
+
+DelegateMeasurer::DelegateMeasurer(Viewport *v) : m_pViewport(v)
+{}
+
+DelegateMeasurer::~DelegateMeasurer()
+{
+    reset();
+}
+
+void DelegateMeasurer::reset()
+{
+    delete m_pItem;
+    delete m_pContext;
+    delete m_pContextAdapter;
+
+    m_pItem           = nullptr;
+    m_pContext        = nullptr;
+    m_pContextAdapter = nullptr;
+    m_pDelegate       = nullptr;
+}
+
+bool DelegateMeasurer::load(const QModelIndex &index)
+{
+    const auto ma = m_pViewport->modelAdapter();
+
+    if (!(m_pDelegate = ma->delegate()))
+        return false;
+
+    // The index has to be set before the context is created
+    m_pContextAdapter = ma->contextAdapterFactory()->createAdapter(
+        ma->view()->rootContext()
+    );
+    m_pContextAdapter->setModelIndex(index);
+
+    // Like AbstractItemAdapter, the delegate has its own context
+    m_pContext = new QQmlContext(m_pContextAdapter->context());
+
+    m_pItem = qobject_cast<QQuickItem*>(m_pDelegate->create(m_pContext));
+
+    if (!m_pItem) {
+        if (!m_pDelegate->errorString().isEmpty())
+            qWarning() << m_pDelegate->errorString();
+
+        return false;
+    }
+
+    m_pViewport->s_ptr->engine()->setObjectOwnership(m_pItem, QQmlEngine::CppOwnership);
+
+    // It has no parent item and is never rendered
+    m_pItem->setVisible(false);
+
+    return true;
+}
+
+QSizeF DelegateMeasurer::measure(const QModelIndex &index)
+{
+    if (!index.isValid())
+        return {};
+
+    if (m_pDelegate != m_pViewport->modelAdapter()->delegate())
+        reset();
+
+    if (!m_pItem) {
+        if (!load(index)) {
+            reset();
+            return {};
+        }
+    }
+    else {
+        // This also flushes the cached roles, so it works for the same index
+        m_pContextAdapter->setModelIndex(index);
+    }
+
+    // Like the real delegates, the width is the one of the view
+    m_pItem->setWidth(m_pViewport->modelAdapter()->view()->width());
+
+    return QSizeF(m_pItem->width(), m_pItem->height());
+}
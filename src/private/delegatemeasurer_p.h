@@ -0,0 +1,64 @@
+/***************************************************************************
+ *   Copyright (C) 2019 by Emmanuel Lepage Vallee                          *
+ *   Author : Emmanuel Lepage Vallee <emmanuel.lepage@kde.org>             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+#ifndef KQUICKITEMVIEWS_DELEGATEMEASURER_P_H
+#define KQUICKITEMVIEWS_DELEGATEMEASURER_P_H
+
+// Qt
+#include <QtCore/QModelIndex>
+#include <QtCore/QSizeF>
+class QQmlComponent;
+class QQmlContext;
+class QQuickItem;
+
+// KQuickItemViews
+class ContextAdapter;
+class Viewport;
+
+/**
+ * Measure the delegate of rows which don't have one.
+ *
+ * The size of a row is otherwise only known once its delegate is created,
+ * which is by far the most expensive part of loading it. This uses a single
+ * hidden delegate instance and rebinds it to each row to measure.
+ *
+ * The delegate doesn't have an AbstractItemAdapter, so the properties which
+ * depend on it are not available. The sizes are only as correct as the
+ * delegate height is a function of the model roles.
+ */
+class DelegateMeasurer final
+{
+public:
+    explicit DelegateMeasurer(Viewport *v);
+    ~DelegateMeasurer();
+
+    QSizeF measure(const QModelIndex &index);
+
+    /// Destroy the instance, for example when the delegate changes
+    void reset();
+
+private:
+    Viewport       *m_pViewport       {nullptr};
+    QQmlComponent  *m_pDelegate       {nullptr};
+    ContextAdapter *m_pContextAdapter {nullptr};
+    QQmlContext    *m_pContext        {nullptr};
+    QQuickItem     *m_pItem           {nullptr};
+
+    bool load(const QModelIndex &index);
+};
+
+#endif
@@ -43,11 +43,14 @@ public:
         UNIFORM , /*!< Assume all elements have the same size, scales well when true  */
         PROXY   , /*!< Use a QSizeHintProxyModel, require work by all developers      */
         ROLE    , /*!< Use one of the QAbstractItemModel role as size                 */
-        DELEGATE, /*!< Assume the view re-implemented ::sizeHint is correct           */
+        DELEGATE, /*!< Measure the rows with a single hidden delegate instance        */
     };
 
     BuiltInStrategies m_CurrentStrategy { BuiltInStrategies::JIT };
 
+    /// Past this many top level rows, measuring them all takes too long
+    static constexpr const int MAX_AHEAD_OF_TIME_ROWS = 10000;
+
     GeometryAdapter    *m_A      {nullptr};
     QAbstractItemModel *m_pModel {nullptr};
     bool                m_Auto   { true  };
@@ -143,6 +146,16 @@ void GeoStrategySelector::setHasScrollbar(bool v)
 {
     d_ptr->m_Features = d_ptr->m_Features & (~Features::HAS_SCROLLBAR);
     d_ptr->m_Features |= v ? Features::HAS_SCROLLBAR : Features::NONE;
+
+    d_ptr->optimize();
+}
+
+void GeoStrategySelector::setHasUniformSize(bool v)
+{
+    d_ptr->m_Features = d_ptr->m_Features & (~Features::HAS_UNIFORM_SIZE);
+    d_ptr->m_Features |= v ? Features::HAS_UNIFORM_SIZE : Features::NONE;
+
+    d_ptr->optimize();
 }
 
 void GeoStrategySelectorPrivate::slotRowsInserted()
@@ -185,14 +198,23 @@ void GeoStrategySelectorPrivate::optimize()
         return;
 
     // Here will eventually reside the main optimization algorithm. For now
-    // just choose between the JustInTime and Proxy adapters, the only ones
-    // fully implemented.
+    // just choose between the JustInTime, Uniform, AheadOfTime, Delegate and
+    // Proxy adapters, the only ones fully implemented.
 
     BuiltInStrategies next = m_CurrentStrategy;
 
     if (m_Features & GeoStrategySelector::Features::HAS_SHP_MODEL) {
         next = BuiltInStrategies::PROXY;
     }
+    else if (m_Features & GeoStrategySelector::Features::HAS_UNIFORM_SIZE) {
+        next = BuiltInStrategies::UNIFORM;
+    }
+    else if (m_Features & GeoStrategySelector::Features::HAS_SCROLLBAR) {
+        // The scrollbar needs the size of the rows which aren't loaded. For
+        // large models, only measure the rows when they are needed.
+        next = m_pModel && m_pModel->rowCount() > MAX_AHEAD_OF_TIME_ROWS ?
+            BuiltInStrategies::DELEGATE : BuiltInStrategies::AOT;
+    }
     else {
         next = BuiltInStrategies::JIT;
     }
@@ -209,7 +231,7 @@ void GeoStrategySelectorPrivate::replaceStrategy(BuiltInStrategies s)
 
     switch(s) {
         case BuiltInStrategies::AOT:
-            //TODO this requires ViewportAdapter to work
+            m_A = new GeometryStrategies::AheadOfTime(q_ptr->viewport());
             break;
         case BuiltInStrategies::JIT:
             m_A = new GeometryStrategies::JustInTime(q_ptr->viewport());
@@ -228,6 +250,12 @@ void GeoStrategySelectorPrivate::replaceStrategy(BuiltInStrategies s)
             break;
     }
 
+    m_CurrentStrategy = s;
+
+    // The forceSize property belongs to the view, not the strategy
+    if (m_A && q_ptr->GeometryAdapter::isSizeForced())
+        m_A->setSizeForced(true);
+
     emit q_ptr->dismissResult();
 }
 
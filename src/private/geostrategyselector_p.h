@@ -53,6 +53,7 @@ public:
         HAS_COLUMNS        = 0x1 << 8 , /*!< The model has more than 1 column        */
         HAS_MAX_DEPTH      = 0x1 << 9 , /*!< There is a known maximum recursion      */
         IS_FULLY_COLLAPSED = 0x1 << 10, /*!< It is a tree, but nothing is expanded   */
+        HAS_UNIFORM_SIZE   = 0x1 << 11, /*!< All elements have the same size         */
     };
     Q_FLAGS(Features)
 
@@ -71,6 +72,9 @@ public:
 
     void setHasScrollbar(bool v);
 
+    /// The view promises all rows have the same height (see Uniform)
+    void setHasUniformSize(bool v);
+
     /// Return true when the currentAdapter is selected using the capabilities.
     bool isAutomatic() const;
 
@@ -19,12 +19,14 @@
 
 // Qt
 #include <QQmlContext>
+#include <QtCore/QVarLengthArray>
 
 //
 #include <private/statetracker/viewitem_p.h>
 #include <private/geostrategyselector_p.h>
 #include "adapters/contextadapter.h"
 #include "adapters/modeladapter.h"
+#include <viewbase.h>
 #include "viewport.h"
 #include "viewport_p.h"
 #include "contextadapterfactory.h"
@@ -35,6 +37,7 @@
 #include "statetracker/index_p.h"
 #include "statetracker/selection_p.h"
 #include "statetracker/modelitem_p.h"
+#include "statetracker/slab_p.h"
 
 class IndexMetadataPrivate
 {
@@ -76,7 +79,7 @@ public:
     virtual QModelIndex          index  () const override;
     virtual AbstractItemAdapter *item   () const override;
 
-    IndexMetadata* m_pGeometry;
+    IndexMetadata* m_pGeometry {nullptr};
 };
 
 #define A &IndexMetadataPrivate::
@@ -90,16 +93,31 @@ const IndexMetadataPrivate::StateF IndexMetadataPrivate::m_fStateMachine[5][7] =
 };
 #undef A
 
+/**
+ * The IndexMetadata are embedded in the ModelItem, which are allocated from a
+ * per-viewport slab (see ContentPrivate::m_Items). Their private has the same
+ * lifetime, so it is allocated contiguously too.
+ *
+ * It cannot be per-viewport, the root IndexMetadata is created before the
+ * Content is reachable from the Viewport. It is shared by all views, like the
+ * rest of the state trackers it is only used from the GUI thread.
+ *
+ * It is never deleted so views destroyed after the static destructors still
+ * have a valid slab. The chunks themselves are released once it is empty.
+ */
+static StateTracker::Slab<IndexMetadataPrivate> &privateSlab()
+{
+    static auto s = new StateTracker::Slab<IndexMetadataPrivate>();
+    return *s;
+}
+
 IndexMetadata::IndexMetadata(StateTracker::Index *idxT, Viewport *p) :
-    d_ptr(new IndexMetadataPrivate(this))
+    d_ptr(privateSlab().create(this))
 {
     Q_ASSERT(idxT);
     d_ptr->m_pIndexTracker     = idxT;
     d_ptr->m_pModelTracker     = (StateTracker::ModelItem*) idxT;
     d_ptr->m_pViewport         = p;
-    d_ptr->m_pProximityTracker = new StateTracker::Proximity(
-        this, indexTracker()
-    );
 }
 
 IndexMetadata::~IndexMetadata()
@@ -110,7 +128,13 @@ IndexMetadata::~IndexMetadata()
         delete d_ptr->m_pContextAdapter;
     }
 
-    delete d_ptr;
+    delete d_ptr->m_pProximityTracker;
+    delete d_ptr->m_pSelectionTracker;
+
+    privateSlab().destroy(d_ptr);
+
+    // The last view is gone, give the memory back
+    privateSlab().release();
 }
 
 void IndexMetadata::setViewTracker(StateTracker::ViewItem *i)
@@ -151,6 +175,13 @@ StateTracker::Geometry *IndexMetadata::geometryTracker() const
 
 StateTracker::Proximity *IndexMetadata::proximityTracker() const
 {
+    // Most elements never need it, so don't allocate it for each of them
+    if (!d_ptr->m_pProximityTracker) {
+        d_ptr->m_pProximityTracker = new StateTracker::Proximity(
+            const_cast<IndexMetadata*>(this), indexTracker()
+        );
+    }
+
     return d_ptr->m_pProximityTracker;
 }
 
@@ -164,6 +195,8 @@ StateTracker::Selection *IndexMetadata::selectionTracker() const
 
 QRectF IndexMetadata::decoratedGeometry() const
 {
+    const bool isBuilt = d_ptr->m_GeoTracker.state() == StateTracker::Geometry::State::VALID;
+
     switch(d_ptr->m_GeoTracker.state()) {
         case StateTracker::Geometry::State::VALID:
         case StateTracker::Geometry::State::PENDING:
@@ -180,6 +213,13 @@ QRectF IndexMetadata::decoratedGeometry() const
 
     Q_ASSERT(d_ptr->m_GeoTracker.state() == StateTracker::Geometry::State::VALID);
 
+    // It was resized or moved, keep track of the extent of the top level rows
+    if ((!isBuilt) && indexTracker()->parent() == modelTracker()->q_ptr->root()) {
+        d_ptr->m_pViewport->s_ptr->m_Extents.setExtent(
+            indexTracker()->effectiveRow(), ret.height()
+        );
+    }
+
     return ret;
 }
 
@@ -199,14 +239,46 @@ ContextAdapter* IndexMetadata::contextAdapter() const
     return d_ptr->m_pContextAdapter;
 }
 
+ContextAdapter *IndexMetadata::takeContextAdapter()
+{
+    auto ret = d_ptr->m_pContextAdapter;
+    d_ptr->m_pContextAdapter = nullptr;
+
+    // While it is in the pool, it must not access this metadata
+    if (ret)
+        ret->m_pGeometry = nullptr;
+
+    return ret;
+}
+
+void IndexMetadata::setContextAdapter(ContextAdapter *a)
+{
+    Q_ASSERT(!d_ptr->m_pContextAdapter);
+
+    auto ctx = static_cast<ViewItemContextAdapter*>(a);
+
+    d_ptr->m_pContextAdapter = ctx;
+    ctx->m_pGeometry = this;
+
+    // The cached roles belong to the previous index. Don't use setModelIndex,
+    // it would keep a QPersistentModelIndex in the context. The index is read
+    // from the item (see ViewItemContextAdapter::index), so it also works
+    // with ModelAdapter::LightweightIndices.
+    if (ctx->isCacheEnabled())
+        ctx->flushCache();
+
+    ctx->updateRoles({});
+}
+
 QModelIndex ViewItemContextAdapter::index() const
 {
-    return m_pGeometry->index();
+    return m_pGeometry ? m_pGeometry->index() : QModelIndex();
 }
 
 AbstractItemAdapter* ViewItemContextAdapter::item() const
 {
-    return m_pGeometry->viewTracker() ? m_pGeometry->viewTracker()->d_ptr : nullptr;
+    return m_pGeometry && m_pGeometry->viewTracker() ?
+        m_pGeometry->viewTracker()->d_ptr : nullptr;
 }
 
 bool IndexMetadata::isValid() const
@@ -246,17 +318,106 @@ QSizeF IndexMetadata::sizeHint()
     Q_ASSERT(s != StateTracker::Geometry::State::POSITION);
 
     if (s == StateTracker::Geometry::State::SIZE) {
-        if (auto prev = up()) {
+        // When the rows in between were unloaded, the parent isn't touching it
+        const auto prev = isAfterGap() ? nullptr : up();
+
+        if (prev) {
+            // After a resize, all the elements below it lose their position.
+            // Asking `prev` for its geometry used to recurse once per element
+            // without a position. Instead, place them in a single pass from
+            // the closest one which still has a position.
+            if (!prev->isValid()) {
+                QVarLengthArray<IndexMetadata*, 64> chain;
+
+                for (auto i = prev; i && !i->isValid(); i = i->up())
+                    chain << i;
+
+                // The first one is positioned from a valid element (or the
+                // origin), then each one from the previous.
+                for (int j = chain.size() - 1; j >= 0; j--)
+                    chain[j]->sizeHint();
+            }
 
-            // A word of warning, this is recursive
             const auto prevGeo = prev->decoratedGeometry();
             Q_ASSERT(prevGeo.y() != -1);
             d_ptr->m_GeoTracker.setPosition(QPointF(0.0, prevGeo.y() + prevGeo.height()));
         }
-        else if (isTopItem()) {
-            d_ptr->m_GeoTracker.setPosition(QPointF(0.0, 0.0));
+        else if (isTopItem() && !(down() && down()->isValid())) {
+            const auto v = viewport()->modelAdapter()->view();
+            d_ptr->m_GeoTracker.setPosition(QPointF(0.0, v->originY()));
             Q_ASSERT(d_ptr->m_GeoTracker.state() == StateTracker::Geometry::State::PENDING);
         }
+        else {
+            // The elements above were unloaded (see Model::trim), so it is
+            // loaded above an element which already has a position. If it is
+            // the top item, the origin will follow (see Flickable::originY).
+            // The same applies to the first children of a parent.
+            //
+            // When more than one element was loaded at once, the ones below
+            // don't have a position either. They cannot use sizeHint() as it
+            // would look up again, so they are placed bottom to top here. The
+            // ones which were not measured yet are measured first.
+            QVarLengthArray<IndexMetadata*, 64> chain;
+
+            const auto adapter = d_ptr->m_pViewport->s_ptr->m_pGeoAdapter;
+
+            auto next = down();
+
+            for (; next && !next->isValid(); next = next->down()) {
+                auto &g = next->d_ptr->m_GeoTracker;
+
+                if (g.state() == StateTracker::Geometry::State::INIT && next->viewTracker())
+                    g.setSize(adapter->sizeHint(next->index(), next->viewTracker()->d_ptr));
+
+                if (g.state() != StateTracker::Geometry::State::SIZE)
+                    break;
+
+                chain << next;
+            }
+
+            const auto decoratedHeight = [](IndexMetadata *md) -> qreal {
+                const auto &g = md->d_ptr->m_GeoTracker;
+                return g.size().height()
+                    + g.borderDecoration(Qt::TopEdge)
+                    + g.borderDecoration(Qt::BottomEdge);
+            };
+
+            // An element which has a position, but not a size, is also an anchor
+            const bool hasAnchor = next && (next->isValid() ||
+                next->d_ptr->m_GeoTracker.state() == StateTracker::Geometry::State::POSITION);
+
+            if (hasAnchor) {
+                qreal y = next->isValid() ?
+                    next->decoratedGeometry().y() : next->d_ptr->m_GeoTracker.position().y();
+
+                for (int j = chain.size() - 1; j >= 0; j--) {
+                    y -= decoratedHeight(chain[j]);
+                    chain[j]->d_ptr->m_GeoTracker.setPosition(QPointF(0.0, y));
+                }
+
+                d_ptr->m_GeoTracker.setPosition(QPointF(0.0, y - decoratedHeight(this)));
+            }
+            else {
+                // Nothing below can be placed yet. Use the estimated position
+                // of the row (see RowExtents), it is corrected once the
+                // elements around it are known.
+                const auto idx = index();
+
+                qreal y = idx.parent().isValid() ?
+                    viewport()->modelAdapter()->view()->originY() :
+                    d_ptr->m_pViewport->s_ptr->rowPosition(idx.row());
+
+                d_ptr->m_GeoTracker.setPosition(QPointF(0.0, y));
+
+                IndexMetadata *prev = this;
+
+                for (auto md : qAsConst(chain)) {
+                    y += decoratedHeight(prev);
+                    md->d_ptr->m_GeoTracker.setPosition(QPointF(0.0, y));
+                    prev = md;
+                }
+            }
+        }
     }
 
     Q_ASSERT(isValid());
@@ -439,7 +600,17 @@ QModelIndex IndexMetadata::index() const
 
 bool IndexMetadata::isTopItem() const
 {
-    return indexTracker() == modelTracker()->q_ptr->firstItem();
+    // When the first rows are trimmed, the first loaded item isn't the top
+    return indexTracker() == modelTracker()->q_ptr->firstItem()
+        && !indexTracker()->modelRow();
+}
+
+bool IndexMetadata::isAfterGap() const
+{
+    const auto i = indexTracker();
+
+    return i->modelRow() && i->parent() && (!i->previousSibling())
+        && i->up() == i->parent();
 }
 
 Viewport *IndexMetadata::viewport() const
@@ -152,6 +152,9 @@ public:
 
     bool isTopItem() const;
 
+    /// The first rows of its parent were unloaded, up() is the parent (see Model::trim)
+    bool isAfterGap() const;
+
     /**
      * Check if the expected geometry and current geometry match.
      *
@@ -161,6 +164,15 @@ public:
 
     void setViewTracker(StateTracker::ViewItem *i);
 
+    /**
+     * Move the context to/from the recycling pool.
+     *
+     * The QML context belongs to the delegate it was created for, so it has
+     * to follow it when the delegate is reused for another index.
+     */
+    ContextAdapter *takeContextAdapter();
+    void setContextAdapter(ContextAdapter *a);
+
     /**
      * Return true when the metadata is complete enough to be displayed.
      *
@@ -0,0 +1,221 @@
+/***************************************************************************
+ *   Copyright (C) 2019 by Emmanuel Lepage Vallee                          *
+ *   Author : Emmanuel Lepage Vallee <emmanuel.lepage@kde.org>             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+#include "rowextents_p.h"
+
+// LibStdC++
+#include <algorithm>
+
+static inline int lowBit(int i)
+{
+    return i & (-i);
+}
+
+int RowExtents::rowCount() const
+{
+    return m_lExtents.size();
+}
+
+bool RowExtents::isKnown(int row) const
+{
+    return row >= 0 && row < m_lExtents.size() && m_lExtents[row] >= 0;
+}
+
+qreal RowExtents::extent(int row) const
+{
+    return isKnown(row) ? m_lExtents[row] : estimatedExtent();
+}
+
+int RowExtents::knownCount() const
+{
+    return m_KnownCount;
+}
+
+qreal RowExtents::estimatedExtent() const
+{
+    return m_KnownCount ? m_KnownTotal / m_KnownCount : 0;
+}
+
+qreal RowExtents::totalExtent() const
+{
+    return m_KnownTotal + (rowCount() - m_KnownCount) * estimatedExtent();
+}
+
+/// O(N), build the trees from the extents
+void RowExtents::rebuild() const
+{
+    const int n = m_lExtents.size();
+
+    m_lSums  .fill(0, n);
+    m_lCounts.fill(0, n);
+
+    for (int i = 1; i <= n; i++) {
+        if (m_lExtents[i-1] >= 0) {
+            m_lSums  [i-1] += m_lExtents[i-1];
+            m_lCounts[i-1] += 1;
+        }
+
+        const int j = i + lowBit(i);
+
+        if (j <= n) {
+            m_lSums  [j-1] += m_lSums  [i-1];
+            m_lCounts[j-1] += m_lCounts[i-1];
+        }
+    }
+
+    m_IsDirty = false;
+}
+
+void RowExtents::add(int row, qreal extent, int count)
+{
+    if (m_IsDirty)
+        return;
+
+    for (int i = row + 1; i <= m_lExtents.size(); i += lowBit(i)) {
+        m_lSums  [i-1] += extent;
+        m_lCounts[i-1] += count;
+    }
+}
+
+/// The sum of the extents of the rows before `row`
+qreal RowExtents::offset(int row) const
+{
+    row = std::max(0, std::min(row, rowCount()));
+
+    if (m_IsDirty)
+        rebuild();
+
+    qreal sum   = 0;
+    int   count = 0;
+
+    for (int i = row; i > 0; i -= lowBit(i)) {
+        sum   += m_lSums  [i-1];
+        count += m_lCounts[i-1];
+    }
+
+    return sum + (row - count) * estimatedExtent();
+}
+
+/// The row which contains `offset`, the offsets are clamped to the rows
+int RowExtents::rowAt(qreal offset) const
+{
+    const int n = rowCount();
+
+    if (!n)
+        return -1;
+
+    if (m_IsDirty)
+        rebuild();
+
+    const qreal est = estimatedExtent();
+
+    int   pos = 0;
+    qreal acc = 0;
+
+    int step = 1;
+    while (step * 2 <= n)
+        step *= 2;
+
+    // Find the number of rows which end at or before `offset`
+    for (; step; step /= 2) {
+        const int next = pos + step;
+
+        if (next > n)
+            continue;
+
+        const qreal s = m_lSums[next-1] + (step - m_lCounts[next-1]) * est;
+
+        if (acc + s <= offset) {
+            pos  = next;
+            acc += s;
+        }
+    }
+
+    return std::min(pos, n - 1);
+}
+
+void RowExtents::setExtent(int row, qreal extent)
+{
+    if (row < 0 || row >= rowCount() || extent < 0)
+        return;
+
+    const qreal old = m_lExtents[row];
+
+    if (old == extent)
+        return;
+
+    const bool wasKnown = old >= 0;
+
+    m_lExtents[row] = extent;
+
+    m_KnownTotal += extent - (wasKnown ? old : 0);
+    m_KnownCount += wasKnown ? 0 : 1;
+
+    add(row, extent - (wasKnown ? old : 0), wasKnown ? 0 : 1);
+}
+
+void RowExtents::insertRows(int first, int last)
+{
+    Q_ASSERT(first >= 0 && first <= rowCount() && last >= first);
+
+    m_lExtents.insert(first, last - first + 1, -1);
+    m_IsDirty = true;
+}
+
+void RowExtents::removeRows(int first, int last)
+{
+    Q_ASSERT(first >= 0 && last < rowCount() && last >= first);
+
+    for (int i = first; i <= last; i++) {
+        if (m_lExtents[i] >= 0) {
+            m_KnownTotal -= m_lExtents[i];
+            m_KnownCount--;
+        }
+    }
+
+    m_lExtents.remove(first, last - first + 1);
+    m_IsDirty = true;
+}
+
+/// Like QAbstractItemModel::beginMoveRows, `destination` is before the move
+void RowExtents::moveRows(int first, int last, int destination)
+{
+    Q_ASSERT(first >= 0 && last < rowCount() && last >= first);
+
+    if (destination >= first && destination <= last + 1)
+        return;
+
+    const int count = last - first + 1;
+    const auto moved = m_lExtents.mid(first, count);
+
+    m_lExtents.remove(first, count);
+
+    const int to = destination > last ? destination - count : destination;
+
+    for (int i = 0; i < count; i++)
+        m_lExtents.insert(to + i, moved[i]);
+
+    m_IsDirty = true;
+}
+
+void RowExtents::reset(int rowCount)
+{
+    m_lExtents.fill(-1, rowCount);
+    m_KnownTotal = 0;
+    m_KnownCount = 0;
+    m_IsDirty    = true;
+}
@@ -0,0 +1,81 @@
+/***************************************************************************
+ *   Copyright (C) 2019 by Emmanuel Lepage Vallee                          *
+ *   Author : Emmanuel Lepage Vallee <emmanuel.lepage@kde.org>             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+#ifndef KQUICKITEMVIEWS_ROWEXTENTS_P_H
+#define KQUICKITEMVIEWS_ROWEXTENTS_P_H
+
+// Qt
+#include <QtCore/QVector>
+
+/**
+ * Remember the height of the top level rows, including the unloaded ones.
+ *
+ * The position of an element is otherwise only known by walking the loaded
+ * elements from the top edge. This makes it impossible to know where a row
+ * which isn't loaded is (or which row is at a given position) without
+ * loading everything in between.
+ *
+ * The extents are reported when the geometry of an element is (re)computed
+ * and are kept after it is unloaded. The rows which were never loaded use the
+ * average of the known extents.
+ *
+ * The prefix sums are stored in a Fenwick tree, so both the row to offset and
+ * offset to row queries are O(log N). Inserting or removing rows is O(N), but
+ * the tree is only rebuilt once, on the next query.
+ *
+ * Only the top level rows are indexed. The children are part of the loaded
+ * elements, which are always used first.
+ */
+class RowExtents final
+{
+public:
+    // Getter
+    int rowCount() const;
+    bool isKnown(int row) const;
+    qreal extent(int row) const;
+    int knownCount() const;
+    qreal estimatedExtent() const;
+    qreal totalExtent() const;
+
+    // Lookup
+    qreal offset(int row) const;
+    int rowAt(qreal offset) const;
+
+    // Mutator
+    void setExtent(int row, qreal extent);
+    void insertRows(int first, int last);
+    void removeRows(int first, int last);
+    void moveRows(int first, int last, int destination);
+    void reset(int rowCount);
+
+private:
+    QVector<qreal> m_lExtents; /*!< -1 when unknown */
+
+    // The Fenwick trees, they are 1 based
+    mutable QVector<qreal> m_lSums  ;
+    mutable QVector<int>   m_lCounts;
+    mutable bool           m_IsDirty {false};
+
+    qreal m_KnownTotal {0};
+    int   m_KnownCount {0};
+
+    // Helpers
+    void rebuild() const;
+    void add(int row, qreal extent, int count);
+};
+
+#endif
@@ -292,8 +292,10 @@ void _test_validateLinkedList(StateTracker::Content *self, bool skipVItemState)
 
         // skipVItemState is necessary to test some steps in between the tree and view
         if (!skipVItemState) {
-            Q_ASSERT(cur->metadata()->modelTracker()->state() == StateTracker::ModelItem::State::VISIBLE || !vi);
-            Q_ASSERT((!visibleFinished) || !vi);
+            // The rows in the buffer also have a (hidden) delegate
+            Q_ASSERT(cur->metadata()->modelTracker()->state() == StateTracker::ModelItem::State::VISIBLE
+                || cur->metadata()->modelTracker()->state() == StateTracker::ModelItem::State::BUFFER
+                || !vi);
         }
 
         // Check the the previous sibling has no children
@@ -523,7 +525,7 @@ void _test_validate_edges_simple(StateTracker::Content *self)
 
 void _test_validate_geometry_cache(StateTracker::Content *self)
 {
-    auto bve = self->edges(IndexMetadata::EdgeType::VISIBLE)->getEdge(Qt::BottomEdge);
+    auto bve = self->edges(IndexMetadata::EdgeType::BUFFERED)->getEdge(Qt::BottomEdge);
     for (auto i = self->root()->firstChild(); i; i = i->down()) {
         Q_ASSERT(i->metadata()->geometryTracker()->state() == StateTracker::Geometry::State::VALID);
 
@@ -604,8 +606,8 @@ void _test_validateContinuity(StateTracker::Content *self)
 #ifndef ENABLE_EXTRA_VALIDATION
     return;
 #endif
-    auto item = self->edges(IndexMetadata::EdgeType::VISIBLE)->getEdge(Qt::TopEdge);
-    auto bve = self->edges(IndexMetadata::EdgeType::VISIBLE)->getEdge(Qt::BottomEdge);
+    auto item = self->edges(IndexMetadata::EdgeType::BUFFERED)->getEdge(Qt::TopEdge);
+    auto bve = self->edges(IndexMetadata::EdgeType::BUFFERED)->getEdge(Qt::BottomEdge);
 
     if (!item)
         return;
@@ -628,7 +630,7 @@ void _test_validateAtEnd(StateTracker::Content *self)
 #endif
     _test_validateContinuity(self);
 
-    auto bve = self->edges(IndexMetadata::EdgeType::VISIBLE)->getEdge(Qt::BottomEdge);
+    auto bve = self->edges(IndexMetadata::EdgeType::BUFFERED)->getEdge(Qt::BottomEdge);
     Q_ASSERT((!self->root()->firstChild()) || bve); //TODO wrong
 
     if (!bve)
@@ -657,7 +659,7 @@ void StateTracker::Index::_test_bridgeGap(StateTracker::Index *first, StateTrack
     if ((!first) && second->m_MoveToRow != -1) {
         Q_ASSERT(second->m_pParent->firstChild());
         Q_ASSERT(second->m_pParent->firstChild() ==second ||
-            second->m_pParent->firstChild()->m_Index.row() < second->m_MoveToRow);
+            second->m_pParent->firstChild()->modelRow() < second->m_MoveToRow);
     }
 
     if (first)
@@ -679,6 +681,27 @@ void StateTracker::Index::_test_bridgeGap(StateTracker::Index *first, StateTrack
 //         Q_ASSERT(second->up() == first);
 //     }
 
+    // The lookup is searched by row, it has to stay sorted. The rows are only
+    // out of order during a move transition.
+    for (auto i : {first, second}) {
+        if (!(i && i->m_pParent))
+            continue;
+
+        const auto &siblings = i->m_pParent->m_lChildren;
+
+        int prevRow = -1;
+
+        for (auto c = siblings.first(); c; c = StateTracker::SiblingTree::next(c)) {
+            if (c->m_LifeCycleState == LifeCycleState::TRANSITION) {
+                prevRow = -1;
+                continue;
+            }
+
+            Q_ASSERT(c->modelRow() >= prevRow);
+            prevRow = c->modelRow();
+        }
+    }
+
     // Close the gap between the old previous and next elements
     Q_ASSERT((!first ) || first->nextSibling()      != first );
     Q_ASSERT((!first ) || first->previousSibling()  != first );
@@ -26,10 +26,19 @@
 #include <private/viewport_p.h>
 #include <private/indexmetadata_p.h>
 #include <private/statetracker/continuity_p.h>
+#include <private/statetracker/slab_p.h>
 #include <adapters/contextadapter.h>
+#include <adapters/modeladapter.h>
+#include <viewbase.h>
 
 // Qt
 #include <QtCore/QDebug>
+#include <QtCore/QTimer>
+#include <QtCore/QPointer>
+#include <QtQuick/QQuickWindow>
+
+// LibStdC++
+#include <algorithm>
 
 using EdgeType = IndexMetadata::EdgeType;
 
@@ -56,22 +65,59 @@ public:
 
     bool isInsertActive(const QModelIndex& p, int first, int last) const;
 
-    QList<StateTracker::Index*> setTemporaryIndices(const QModelIndex &parent, int start, int end,
-                             const QModelIndex &destination, int row);
-    void resetTemporaryIndices(const QList<StateTracker::Index*>&);
+    void setTemporaryIndices(const QVector<StateTracker::Index*> &moved,
+                             const QModelIndex &destination, int delta);
+    void resetTemporaryIndices(const QVector<StateTracker::Index*>&);
+
+    // Removal transactions
+    void beginRemoval();
+    void commitRemoval();
 
-    void reloadEdges();
+    void destroyTree(StateTracker::ModelItem *item);
+
+    // Lightweight row identity
+    bool isLightweight() const;
+    void dropIndex(StateTracker::Index *i);
+    void restoreIndex(StateTracker::Index *i);
+    void restoreChildren(StateTracker::Index *pitem);
+    void shiftRows(const QModelIndex& parent, int from, int delta);
 
     StateTracker::ModelItem *m_pRoot {nullptr};
 
+    /// All ModelItem of this viewport are allocated contiguously
+    StateTracker::Slab<StateTracker::ModelItem> m_Items;
+
+    bool m_IsRemoving {false};
+
+    /// The moved rows were unloaded and must be loaded at their destination
+    bool m_LoadMovedRows {false};
+
+    /// Upper bound of the number of elements without a QPersistentModelIndex
+    int m_LightCount {0};
+
+    /**
+     * The dataChanged() coalescing.
+     *
+     * Each item maps to the union of the roles it needs to refresh. An empty
+     * vector means "all roles", like in QAbstractItemModel::dataChanged.
+     */
+    QHash<StateTracker::ModelItem*, QVector<int>> m_hPendingUpdates;
+    QPointer<QQuickWindow> m_pFlushWindow;
+    bool m_IsFlushScheduled {false};
+
+    void schedulePendingUpdates();
+
+    /// The range of loaded rows of each parent before the layoutChanged
+    QHash<StateTracker::Index*, QPair<int, int>> m_hRelayout;
+
+    void snapshotLayout(StateTracker::Index *pitem);
+    void relayout(StateTracker::Index *pitem);
+
     //TODO add a circular buffer to GC the items
     // * relative index: when to trigger GC
     // * absolute array index: kept in the StateTracker::ModelItem so it can
     //   remove itself
 
-    /// All elements with loaded children
-    QHash<QPersistentModelIndex, StateTracker::ModelItem*> m_hMapper;
-
     QModelIndex getNextIndex(const QModelIndex& idx) const;
 
     ModelRect m_lRects[3];
@@ -81,92 +127,169 @@ public:
     StateTracker::Content* q_ptr;
 
     // Update the ModelRect
-    void insertEdge(IndexMetadata *, StateTracker::ModelItem::State);
-    void removeEdge(IndexMetadata *, StateTracker::ModelItem::State);
+    void insertEdge      (IndexMetadata *, StateTracker::ModelItem::State);
+    void removeEdge      (IndexMetadata *, StateTracker::ModelItem::State);
+    void insertBufferEdge(IndexMetadata *, StateTracker::ModelItem::State);
+    void removeBufferEdge(IndexMetadata *, StateTracker::ModelItem::State);
     void enterState(IndexMetadata *, StateTracker::ModelItem::State);
     void leaveState(IndexMetadata *, StateTracker::ModelItem::State);
     void error     (IndexMetadata *, StateTracker::ModelItem::State);
     void resetState(IndexMetadata *, StateTracker::ModelItem::State);
+    void enterDangling(IndexMetadata *, StateTracker::ModelItem::State);
+    void enterReachable(IndexMetadata *, StateTracker::ModelItem::State);
+    void enterMoving  (IndexMetadata *, StateTracker::ModelItem::State);
 
     typedef void(ContentPrivate::*StateFS)(IndexMetadata*, StateTracker::ModelItem::State);
     static const StateFS m_fStateLogging[8][2];
 
+    typedef bool(*EdgeFilter)(StateTracker::Index*);
+    void growEdges  (EdgeType et, StateTracker::Index *tti, EdgeFilter inRange);
+    void shrinkEdges(EdgeType et, StateTracker::Index *tti, EdgeFilter inRange);
+
 public Q_SLOTS:
+    void flushPendingUpdates();
     void slotCleanup();
     void slotRowsInserted  (const QModelIndex& parent, int first, int last);
     void slotRowsRemoved   (const QModelIndex& parent, int first, int last);
+    void slotShiftInserted (const QModelIndex& parent, int first, int last);
+    void slotShiftRemoved  (const QModelIndex& parent, int first, int last);
+    void slotLayoutAboutToBeChanged(                                      );
     void slotLayoutChanged (                                              );
+    void slotModelReset    (                                              );
     void slotDataChanged   (const QModelIndex& tl, const QModelIndex& br,
                             const QVector<int> &roles  );
     void slotRowsMoved     (const QModelIndex &p, int start, int end,
                             const QModelIndex &dest, int row);
+    void slotLoadMovedRows (const QModelIndex &p, int start, int end,
+                            const QModelIndex &dest, int row);
 };
 
 #define A &ContentPrivate::
 // Keep track of the number of instances per state
 const ContentPrivate::StateFS ContentPrivate::m_fStateLogging[8][2] = {
-/*                ENTER           LEAVE    */
-/*NEW      */ { A error     , A leaveState },
-/*BUFFER   */ { A enterState, A leaveState },
-/*REMOVED  */ { A enterState, A leaveState },
-/*REACHABLE*/ { A enterState, A leaveState },
-/*VISIBLE  */ { A insertEdge, A removeEdge },
-/*ERROR    */ { A enterState, A leaveState },
-/*DANGLING */ { A enterState, A error      },
-/*MOVING   */ { A enterState, A resetState },
+/*                   ENTER                LEAVE       */
+/*NEW      */ { A error           , A leaveState       },
+/*BUFFER   */ { A insertBufferEdge, A removeBufferEdge },
+/*REMOVED  */ { A enterState      , A leaveState       },
+/*REACHABLE*/ { A enterReachable  , A leaveState       },
+/*VISIBLE  */ { A insertEdge      , A removeEdge       },
+/*ERROR    */ { A enterState      , A leaveState       },
+/*DANGLING */ { A enterDangling   , A error            },
+/*MOVING   */ { A enterMoving     , A resetState       },
 };
 #undef A
 
-void ContentPrivate::insertEdge(IndexMetadata *md, StateTracker::ModelItem::State s)
+static bool isVisible(StateTracker::Index *i)
 {
-    auto tti = md->modelTracker();
-    Q_UNUSED(s)
-    const auto first = q_ptr->edges(EdgeType::VISIBLE)->getEdge(  Qt::TopEdge   );
-    const auto last  = q_ptr->edges(EdgeType::VISIBLE)->getEdge( Qt::BottomEdge );
+    return i->metadata()->modelTracker()->state() == StateTracker::ModelItem::State::VISIBLE;
+}
 
-    const auto prev = tti->up();
-    const auto next = tti->down();
+static bool isBuffered(StateTracker::Index *i)
+{
+    const auto s = i->metadata()->modelTracker()->state();
+
+    return s == StateTracker::ModelItem::State::VISIBLE
+        || s == StateTracker::ModelItem::State::BUFFER;
+}
+
+/**
+ * Extend the `et` edges when `tti` enters the range.
+ *
+ * The ranges are always continuous, so only an element next to an edge (or
+ * the first element) can extend it. If the elements next to it already were
+ * in the range (but disconnected until `tti` joined them), they are included
+ * too. They will never be walked again, so it is O(1) amortized.
+ */
+void ContentPrivate::growEdges(EdgeType et, StateTracker::Index *tti, EdgeFilter inRange)
+{
+    const auto first = q_ptr->edges(et)->getEdge(  Qt::TopEdge   );
+    const auto last  = q_ptr->edges(et)->getEdge( Qt::BottomEdge );
 
-    if (first == next)
-        q_ptr->setEdge(EdgeType::VISIBLE, tti, Qt::TopEdge);
+    const bool isFirst = (!first) && !last;
 
-    if (last == prev)
-        q_ptr->setEdge(EdgeType::VISIBLE, tti, Qt::BottomEdge);
+    if (isFirst || first == tti->down()) {
+        auto top = tti;
 
-    _DO_TEST(_test_validate_edges_simple, q_ptr)
+        while (top->up() && top->up() != last && inRange(top->up()))
+            top = top->up();
+
+        q_ptr->setEdge(et, top, Qt::TopEdge);
+    }
+
+    if (isFirst || last == tti->up()) {
+        auto bottom = tti;
+
+        while (bottom->down() && bottom->down() != first && inRange(bottom->down()))
+            bottom = bottom->down();
+
+        q_ptr->setEdge(et, bottom, Qt::BottomEdge);
+    }
 }
 
-void ContentPrivate::removeEdge(IndexMetadata *md, StateTracker::ModelItem::State s)
+/// Move the `et` edges inward when `tti` leaves the range
+void ContentPrivate::shrinkEdges(EdgeType et, StateTracker::Index *tti, EdgeFilter inRange)
 {
-    Q_UNUSED(s)
-    auto tti = md->modelTracker();
-    const auto first = q_ptr->edges(EdgeType::VISIBLE)->getEdge(Qt::TopEdge);
-    const auto last  = q_ptr->edges(EdgeType::VISIBLE)->getEdge(Qt::BottomEdge);
+    const auto first = q_ptr->edges(et)->getEdge(Qt::TopEdge);
+    const auto last  = q_ptr->edges(et)->getEdge(Qt::BottomEdge);
 
     // The item was somewhere in between, not an edge case
     if ((tti != first) && (tti != last))
         return;
 
-    auto prev = tti->up();
-    auto next = tti->down();
+    const auto prev = tti->up();
+    const auto next = tti->down();
 
     if (tti == first)
-        q_ptr->setEdge(EdgeType::VISIBLE,
-            (next && next->metadata()->modelTracker()->state() == StateTracker::ModelItem::State::VISIBLE) ?
-                next : nullptr,
-            Qt::TopEdge
-        );
+        q_ptr->setEdge(et, (tti != last && next && inRange(next)) ? next : nullptr, Qt::TopEdge);
 
     if (tti == last)
-        q_ptr->setEdge(EdgeType::VISIBLE,
-            (prev && prev->metadata()->modelTracker()->state() == StateTracker::ModelItem::State::VISIBLE) ?
-                prev : nullptr,
-            Qt::BottomEdge
-        );
+        q_ptr->setEdge(et, (tti != first && prev && inRange(prev)) ? prev : nullptr, Qt::BottomEdge);
+}
+
+void ContentPrivate::insertEdge(IndexMetadata *md, StateTracker::ModelItem::State s)
+{
+    Q_UNUSED(s)
+    auto tti = md->modelTracker();
+
+    restoreIndex(tti);
+
+    growEdges(EdgeType::VISIBLE , tti, isVisible );
+    growEdges(EdgeType::BUFFERED, tti, isBuffered);
+
+    _DO_TEST(_test_validate_edges_simple, q_ptr)
+}
+
+void ContentPrivate::removeEdge(IndexMetadata *md, StateTracker::ModelItem::State s)
+{
+    Q_UNUSED(s)
+    auto tti = md->modelTracker();
+
+    shrinkEdges(EdgeType::VISIBLE, tti, isVisible);
+
+    // Hiding an element keeps it in the buffer
+    if (tti->state() != StateTracker::ModelItem::State::BUFFER)
+        shrinkEdges(EdgeType::BUFFERED, tti, isBuffered);
 
     _DO_TEST(_test_validate_edges_simple, q_ptr)
 }
 
+void ContentPrivate::insertBufferEdge(IndexMetadata *md, StateTracker::ModelItem::State s)
+{
+    Q_UNUSED(s)
+    restoreIndex(md->modelTracker());
+    growEdges(EdgeType::BUFFERED, md->modelTracker(), isBuffered);
+}
+
+void ContentPrivate::removeBufferEdge(IndexMetadata *md, StateTracker::ModelItem::State s)
+{
+    Q_UNUSED(s)
+    auto tti = md->modelTracker();
+
+    // Showing an element keeps it in the buffer
+    if (tti->state() != StateTracker::ModelItem::State::VISIBLE)
+        shrinkEdges(EdgeType::BUFFERED, tti, isBuffered);
+}
+
 /**
  * This method is called when an item moves into a new area and the "real"
  * new state needs to be determined.
@@ -183,7 +306,7 @@ StateTracker::Content::Content(Viewport* parent) : QObject(parent),
     d_ptr(new ContentPrivate())
 {
     d_ptr->m_pViewport     = parent;
-    d_ptr->m_pRoot         = new StateTracker::ModelItem(parent);
+    d_ptr->m_pRoot         = d_ptr->m_Items.create(parent);
     d_ptr->m_pModelTracker = new StateTracker::Model(this);
     d_ptr->q_ptr           = this;
 }
@@ -192,7 +315,7 @@ StateTracker::Content::~Content()
 {
     delete d_ptr->m_pModelTracker;
     d_ptr->m_pModelTracker = nullptr;
-    delete d_ptr->m_pRoot;
+    d_ptr->m_Items.destroy(d_ptr->m_pRoot);
 }
 
 void ContentPrivate::slotRowsInserted(const QModelIndex& parent, int first, int last)
@@ -208,7 +331,7 @@ void ContentPrivate::slotRowsInserted(const QModelIndex& parent, int first, int
         return;
     }
 
-    const auto pitem = parent.isValid() ? m_hMapper.value(parent) : m_pRoot;
+    const auto pitem = parent.isValid() ? ttiForIndex(parent) : m_pRoot;
 
     //FIXME it is possible if the anchor is at the bottom that the parent
     // needs to be loaded. But this is currently too not supported.
@@ -217,27 +340,63 @@ void ContentPrivate::slotRowsInserted(const QModelIndex& parent, int first, int
         return;
     }
 
+    const auto model = m_pModelTracker->modelCandidate();
+
     StateTracker::Index *prev = nullptr;
 
     //FIXME use up()
-    if (first && pitem)
-        prev = pitem->childrenLookup(m_pModelTracker->modelCandidate()->index(first-1, 0, parent));
+    if (first)
+        prev = pitem->childrenLookup(first - 1);
+
+    // The first loaded sibling after the range. If it is within the range,
+    // then the range is already partially loaded and has to stop before it.
+    const auto after = pitem->childrenLowerBound(first);
+
+    if (after && after->effectiveRow() <= last)
+        last = after->effectiveRow() - 1;
+
+    if (last < first) {
+        _DO_TEST(_test_validateLinkedList, q_ptr)
+        return;
+    }
+
+    // Find the element loaded right after the range, it is either a sibling
+    // or a [[great]grand]uncle.
+    StateTracker::Index *follower = after;
+
+    for (auto i = pitem; (!follower) && i && i != m_pRoot; i = i->parent())
+        follower = i->nextSibling();
+
+    // If the insertion is sandwiched between loaded items, not doing it
+    // will corrupt the view, but if it's a "tail" insertion, then they
+    // can be discarded.
+    bool sandwiched = after ? after->effectiveRow() == last + 1 :
+        follower && last + 1 == model->rowCount(parent);
+
+    const bool hasRoom = q_ptr->edges(EdgeType::FREE)->m_Edges & (Qt::BottomEdge | Qt::TopEdge);
 
     // There is no choice here but to load a larger subset to avoid holes, in
     // theory, edges(EdgeType::FREE)->m_Edges will prevent runaway loading
-    if (pitem->firstChild())
-        last = std::max(last, pitem->firstChild()->effectiveRow() - 1);
+    if (hasRoom && after && (!sandwiched) && after == pitem->firstChild()) {
+        last       = after->effectiveRow() - 1;
+        sandwiched = true;
+    }
+
+    // The rows are after the last loaded element and the view is full, skip
+    // the whole range without looking at it.
+    if (!(sandwiched || hasRoom)) {
+        _DO_TEST(_test_validateLinkedList, q_ptr)
+        return;
+    }
+
+    // Only refresh the visible elements once, after the whole range is loaded
+    m_pViewport->s_ptr->beginTransaction();
 
     if (prev && prev->down()) {
         m_pViewport->s_ptr->notifyInsert(prev->down()->metadata());
         //Q_ASSERT(!TTI(prev->down())->metadata()->isValid());
     }
-    else if ((!prev) && (!pitem) && m_pRoot->firstChild()) {
-        Q_ASSERT((!first) && !parent.isValid());
-        m_pViewport->s_ptr->notifyInsert(m_pRoot->firstChild()->metadata());
-        //Q_ASSERT(!TTI(m_pRoot->firstChild())->metadata()->isValid());
-    }
-    else if (pitem && pitem != m_pRoot && pitem->down()) {
+    else if (pitem != m_pRoot && pitem->down()) {
         //Q_ASSERT(!first);
         m_pViewport->s_ptr->notifyInsert(pitem->down()->metadata());
 
@@ -245,113 +404,77 @@ void ContentPrivate::slotRowsInserted(const QModelIndex& parent, int first, int
         //Q_ASSERT(!TTI(pitem->down())->metadata()->isValid());
     }
 
-    //FIXME support smaller ranges
-    for (int i = first; i <= last; i++) {
-        auto idx = m_pModelTracker->modelCandidate()->index(i, 0, parent);
-        Q_ASSERT(idx.isValid() && idx.parent() != idx && idx.model() == m_pModelTracker->modelCandidate());
-
-        // If the insertion is sandwiched between loaded items, not doing it
-        // will corrupt the view, but if it's a "tail" insertion, then they
-        // can be discarded.
-        if (!(q_ptr->edges(EdgeType::FREE)->m_Edges & (Qt::BottomEdge | Qt::TopEdge))) {
-            const auto nextIdx = getNextIndex(idx);
-            const auto nextTTI = nextIdx.isValid() ? ttiForIndex(nextIdx) : nullptr;
-
-            if (!nextTTI) {
-                m_pViewport->s_ptr->refreshVisible();
-                _DO_TEST(_test_validateLinkedList, q_ptr)
-                return; //FIXME break
-            }
-        }
-
-        auto e = addChildren(idx);
-
-        if (pitem->firstChild() && pitem->firstChild()->effectiveRow() == idx.row()+1) {
-            Q_ASSERT(idx.parent() == pitem->firstChild()->effectiveParentIndex());
-
-//             m_pViewport->s_ptr->notifyInsert(&TTI(pitem->firstChild())->m_Geometry);
-            StateTracker::Index::insertChildBefore(e, pitem->firstChild(), pitem);
-        }
-        else {
-            StateTracker::Index::insertChildAfter(e, prev, pitem); //FIXME incorrect
-//             m_pViewport->s_ptr->notifyInsert(&TTI(prev)->m_Geometry);
-        }
-
-        //FIXME It can happen if the previous is out of the visible range
-        Q_ASSERT( e->previousSibling() || e->nextSibling() || e->effectiveRow() == 0);
-
-        //TODO merge with bridgeGap
-        if (prev) {
-            StateTracker::Index::bridgeGap(prev, e);
-            _DO_TEST_IDX(_test_validate_chain, prev->parent())
-        }
-
-        // This is required before ::ATTACH because otherwise ::down() wont work
+    // Drop the elements of a batch which were never attached. They are
+    // removed from the end to keep the chain continuous.
+    const auto drop = [](const QVector<StateTracker::Index*>& chain, int from) {
+        for (int k = chain.size() - 1; k >= from; k--)
+            chain[k]->metadata() << IndexMetadata::LoadAction::DETACH;
+    };
 
-        Q_ASSERT((!pitem->firstChild()) || !pitem->firstChild()->hasTemporaryIndex()); //TODO
+    // When the rows are only loaded to fill the free space, it isn't known in
+    // advance how many will fit. Use increasingly larger batches to avoid
+    // creating (a lot) more elements than necessary.
+    int batchSize = 16;
 
-        const bool needDownMove = (!pitem->lastChild()) ||
-            e->effectiveRow() > pitem->lastChild()->effectiveRow();
+    for (int i = first; i <= last;) {
+        QVector<StateTracker::Index*> chain;
 
-        const bool needUpMove = (!pitem->firstChild()) ||
-            e->effectiveRow() < pitem->firstChild()->effectiveRow();
+        const int batchEnd = sandwiched ? last : std::min(last, i + batchSize - 1);
+        batchSize *= 2;
 
-        _DO_TEST_IDX(_test_validate_chain, e->parent())
+        // Create all elements of the batch in one pass
+        while (i <= batchEnd) {
+            const auto idx = model->index(i++, 0, parent);
+            Q_ASSERT(idx.isValid() && idx.parent() != idx && idx.model() == model);
 
-        // The item is about the current parent first item
-        if (needUpMove) {
-//             Q_ASSERT(false); //TODO merge with the other bridgeGap above
+            chain << addChildren(idx);
 
-            m_pViewport->s_ptr->notifyInsert(m_pRoot->firstChild()->metadata());
-            Q_ASSERT((!m_pRoot->firstChild()) || !m_pRoot->firstChild()->metadata()->isValid());
-            StateTracker::Index::insertChildBefore(e, nullptr, pitem);
+            // The children will be loaded (if there is room) before the next
+            // sibling, so it cannot be created yet.
+            if ((!sandwiched) && model->hasChildren(idx))
+                break;
         }
 
-        _DO_TEST_IDX(_test_validate_chain, e->parent())
-
-        Q_ASSERT(e->metadata()->geometryTracker()->state() == StateTracker::Geometry::State::INIT);
-        Q_ASSERT(e->state() != StateTracker::ModelItem::State::VISIBLE);
+        // Then link them all at once
+        StateTracker::Index::insertChildrenBefore(chain, after, pitem);
 
-        // NEW -> REACHABLE, this should never fail
-        if (!e->metadata()->performAction(IndexMetadata::LoadAction::ATTACH)) {
-            qDebug() << "\n\nATTACH FAILED";
-            _DO_TEST(_test_validateLinkedList, q_ptr)
-            break;
-        }
+        for (int j = 0; j < chain.size(); j++) {
+            auto e = static_cast<StateTracker::ModelItem*>(chain[j]);
 
-        if (needUpMove) {
-            Q_ASSERT(pitem != e);
-            if (auto pe = e->up())
-                pe->metadata() << IndexMetadata::LoadAction::MOVE;
-        }
-
-        Q_ASSERT((!pitem->lastChild()) || !pitem->lastChild()->hasTemporaryIndex()); //TODO
+            // The view is full, the other rows are not needed
+            if ((!sandwiched) && !(q_ptr->edges(EdgeType::FREE)->m_Edges & (Qt::BottomEdge | Qt::TopEdge))) {
+                drop(chain, j);
+                i = last + 1;
+                break;
+            }
 
-        if (needDownMove) {
-            if (auto ne = e->down()) {
-                Q_ASSERT(!ne->metadata()->isValid());
+            Q_ASSERT(e->metadata()->geometryTracker()->state() == StateTracker::Geometry::State::INIT);
+            Q_ASSERT(e->state() != StateTracker::ModelItem::State::VISIBLE);
 
-                ne->metadata() << IndexMetadata::LoadAction::MOVE;
-                Q_ASSERT(!ne->metadata()->isValid());
+            // NEW -> REACHABLE, this should never fail
+            if (!e->metadata()->performAction(IndexMetadata::LoadAction::ATTACH)) {
+                qDebug() << "\n\nATTACH FAILED";
+                drop(chain, j + 1);
+                i = last + 1;
+                break;
             }
-        }
 
-        int rc = m_pModelTracker->modelCandidate()->rowCount(idx);
-        if (rc && q_ptr->edges(EdgeType::FREE)->m_Edges & Qt::BottomEdge) {
-            slotRowsInserted(idx, 0, rc-1);
-        }
+            const int rc = model->rowCount(e->index());
+            if (rc && q_ptr->edges(EdgeType::FREE)->m_Edges & Qt::BottomEdge) {
+                slotRowsInserted(e->index(), 0, rc-1);
+            }
 
-        // Validate early to prevent propagating garbage that's nearly impossible
-        // to debug.
-        if (pitem && pitem != m_pRoot && !i) {
-            Q_ASSERT(e->up() == pitem);
-            Q_ASSERT(e == pitem->down());
+            // Validate early to prevent propagating garbage that's nearly impossible
+            // to debug.
+            if (pitem != m_pRoot && e == pitem->firstChild()) {
+                Q_ASSERT(e->up() == pitem);
+                Q_ASSERT(e == pitem->down());
+            }
         }
-
-        prev = e;
     }
 
     m_pViewport->s_ptr->refreshVisible();
+    m_pViewport->s_ptr->commitTransaction();
 
     _DO_TEST(_test_validateLinkedList, q_ptr)
     _DO_TEST_IDX(_test_validate_chain, pitem)
@@ -369,270 +492,628 @@ void ContentPrivate::slotRowsRemoved(const QModelIndex& parent, int first, int l
         return;
     }
 
-    auto pitem = parent.isValid() ? m_hMapper.value(parent) : m_pRoot;
+    auto pitem = parent.isValid() ? ttiForIndex(parent) : m_pRoot;
 
     if (!pitem)
         return;
 
+    // The range is entirely outside of the loaded elements
+    if ((!pitem->firstChild()) || pitem->firstChild()->modelRow() > last
+      || pitem->lastChild()->modelRow() < first) {
+        _DO_TEST(_test_validateLinkedList, q_ptr)
+        return;
+    }
+
     //TODO make sure the state machine support them
     //StateTracker::ModelItem *prev(nullptr), *next(nullptr);
 
     //FIXME use up()
     //if (first && pitem)
-    //    prev = pitem->m_hLookup.value(model()->index(first-1, 0, parent));
+    //    prev = pitem->childrenLookup(first - 1);
 
-    //next = pitem->m_hLookup.value(model()->index(last+1, 0, parent));
+    //next = pitem->childrenLookup(last + 1);
 
-    //FIXME support smaller ranges
-    for (int i = first; i <= last; i++) {
-        auto idx = m_pModelTracker->modelCandidate()->index(i, 0, parent);
+    beginRemoval();
 
-        if (auto elem = pitem->childrenLookup(idx)) {
-            elem->metadata()
-                << IndexMetadata::LoadAction::HIDE
-                << IndexMetadata::LoadAction::DETACH;
-        }
+    // Only visit the loaded elements, not every row of the range
+    auto elem = pitem->childrenLowerBound(first);
+
+    const auto before = elem ? elem->metadata()->up() : nullptr;
+
+    while (elem && elem->modelRow() <= last) {
+        // DETACH deletes `elem`
+        auto next = elem->nextSibling();
+
+        elem->metadata()
+            << IndexMetadata::LoadAction::HIDE
+            << IndexMetadata::LoadAction::DETACH;
+
+        elem = next;
     }
 
+    // When the rows were above the viewport, the elements above them move
+    // down instead of moving everything below up (see ViewportSync::reflowUp)
+    const auto after = before ? before->down() : (
+        q_ptr->firstItem() ? q_ptr->firstItem()->metadata() : nullptr
+    );
+
+    if (after)
+        m_pViewport->s_ptr->notifyInsert(after);
+
+    commitRemoval();
+
     Q_EMIT q_ptr->contentChanged();
 }
 
-//TODO optimize this
-void ContentPrivate::slotDataChanged(const QModelIndex& tl, const QModelIndex& br, const QVector<int> &roles)
+bool ContentPrivate::isLightweight() const
 {
-    Q_ASSERT(((!tl.isValid()) || tl.model() == m_pModelTracker->modelCandidate()));
-    Q_ASSERT(((!br.isValid()) || br.model() == m_pModelTracker->modelCandidate()));
+    return m_pViewport->modelAdapter()->indexTrackingMode()
+        == ModelAdapter::IndexTrackingMode::LightweightIndices;
+}
 
-    if (!q_ptr->isActive(tl.parent(), tl.row(), br.row()))
+void ContentPrivate::dropIndex(StateTracker::Index *i)
+{
+    if ((!isLightweight()) || i->lifeCycleState() != StateTracker::Index::LifeCycleState::NORMAL)
         return;
 
-    for (int i = tl.row(); i <= br.row(); i++) {
-        const auto idx = m_pModelTracker->modelCandidate()->index(i, tl.column(), tl.parent());
-        if (auto tti = ttiForIndex(idx)) {
-            if (tti->metadata()->viewTracker()) {
-                tti->metadata()->contextAdapter()->updateRoles(roles);
-                tti->metadata() << IndexMetadata::ViewAction::UPDATE;
-            }
-        }
-    }
+    if (!i->hasPersistentIndex())
+        return;
+
+    i->dropPersistentIndex();
+
+    if (!i->hasPersistentIndex())
+        m_LightCount++;
 }
 
-void ContentPrivate::slotLayoutChanged()
+void ContentPrivate::restoreIndex(StateTracker::Index *i)
 {
-    if (auto rc = m_pModelTracker->modelCandidate()->rowCount())
-        slotRowsInserted({}, 0, rc - 1);
+    if (i->hasPersistentIndex())
+        return;
 
-    Q_EMIT q_ptr->contentChanged();
+    i->restorePersistentIndex();
+    m_LightCount--;
 }
 
-void ContentPrivate::slotRowsMoved(const QModelIndex &parent, int start, int end,
-                                     const QModelIndex &destination, int row)
+void ContentPrivate::restoreChildren(StateTracker::Index *pitem)
 {
-    Q_ASSERT((!parent.isValid()) || parent.model() == m_pModelTracker->modelCandidate());
-    Q_ASSERT((!destination.isValid()) || destination.model() == m_pModelTracker->modelCandidate());
+    if (!pitem)
+        return;
 
-    // There is literally nothing to do
-    if (parent == destination && start == row)
+    for (auto i = pitem->firstChild(); i; i = i->nextSibling())
+        restoreIndex(i);
+}
+
+/**
+ * Update the elements without a QPersistentModelIndex after the model
+ * inserted or removed rows before them.
+ *
+ * The model already updated the other elements. All the elements before
+ * `from` are unchanged and all the ones after it have a row equal or greater
+ * than `from` (shifted or not), so the lookup still works.
+ */
+void ContentPrivate::shiftRows(const QModelIndex& parent, int from, int delta)
+{
+    if (!m_LightCount)
         return;
 
-    // Whatever has to be done only affect a part that's not currently tracked.
-    if (!q_ptr->isActive(destination, row, row)) {
-        //Q_ASSERT(false); //TODO so I don't forget
+    const auto pitem = parent.isValid() ? ttiForIndex(parent) : m_pRoot;
+
+    if (!pitem)
         return;
+
+    for (auto i = pitem->childrenLowerBound(from); i; i = i->nextSibling()) {
+        if (!i->hasPersistentIndex())
+            i->shiftRow(delta);
     }
+}
+
+void ContentPrivate::slotShiftInserted(const QModelIndex& parent, int first, int last)
+{
+    if (!parent.isValid())
+        m_pViewport->s_ptr->m_Extents.insertRows(first, last);
+
+    shiftRows(parent, first, last - first + 1);
+}
+
+void ContentPrivate::slotShiftRemoved(const QModelIndex& parent, int first, int last)
+{
+    if (!parent.isValid())
+        m_pViewport->s_ptr->m_Extents.removeRows(first, last);
+
+    shiftRows(parent, first, first - last - 1);
+}
+
+/**
+ * Removing elements one by one used to refresh the whole visible area after
+ * each of them. Within a removal transaction, the detached elements only mark
+ * the viewport as dirty. The edges are kept up to date by the state
+ * transitions (see m_fStateLogging).
+ */
+void ContentPrivate::beginRemoval()
+{
+    Q_ASSERT(!m_IsRemoving);
+
+    m_IsRemoving = true;
+
+    m_pViewport->s_ptr->beginTransaction();
+}
 
-    auto tmp = setTemporaryIndices(parent, start, end, destination, row);
+void ContentPrivate::commitRemoval()
+{
+    Q_ASSERT(m_IsRemoving);
 
-    // As the actual view is implemented as a daisy chained list, only moving
-    // the edges is necessary for the StateTracker::ModelItem. Each StateTracker::ViewItem
-    // need to be moved.
+    m_IsRemoving = false;
 
-    const auto idxStart = m_pModelTracker->modelCandidate()->index(start, 0, parent);
-    const auto idxEnd   = m_pModelTracker->modelCandidate()->index(end  , 0, parent);
-    Q_ASSERT(idxStart.isValid() && idxEnd.isValid());
+    m_pViewport->s_ptr->commitTransaction();
+}
 
-    //FIXME once partial ranges are supported, this is no longer always valid
-    auto startTTI = ttiForIndex(idxStart);
-    auto endTTI   = ttiForIndex(idxEnd);
+/**
+ * Models such as live feeds can emit a very large number of dataChanged for
+ * large ranges. Only the loaded part of the range is relevant and nothing
+ * has to be refreshed more than once per frame.
+ *
+ * The range is first intersected with the loaded children (O(log N + K), K
+ * being the number of loaded items in the range) then accumulated into
+ * `m_hPendingUpdates`. It is flushed once before the next scene graph sync.
+ */
+void ContentPrivate::slotDataChanged(const QModelIndex& tl, const QModelIndex& br, const QVector<int> &roles)
+{
+    Q_ASSERT(((!tl.isValid()) || tl.model() == m_pModelTracker->modelCandidate()));
+    Q_ASSERT(((!br.isValid()) || br.model() == m_pModelTracker->modelCandidate()));
 
-    if (end - start == 1)
-        Q_ASSERT(startTTI->nextSibling() == endTTI);
+    if ((!tl.isValid()) || (!br.isValid()) || tl.row() > br.row())
+        return;
 
+    Q_ASSERT(tl.parent() == br.parent());
 
-    //FIXME so I don't forget, it will mess things up if silently ignored
-    Q_ASSERT(startTTI->parent() == endTTI->parent()); //TODO not implemented
-    Q_ASSERT(startTTI && endTTI); //TODO partially loaded move are not implemented
+    const auto pitem = tl.parent().isValid() ? ttiForIndex(tl.parent()) : m_pRoot;
 
-    auto oldPreviousTTI = startTTI->up();
-    auto oldNextTTI     = endTTI->down();
+    if ((!pitem) || !pitem->firstChild())
+        return;
 
-    Q_ASSERT((!oldPreviousTTI) || oldPreviousTTI->down() == startTTI);
-    Q_ASSERT((!oldNextTTI) || oldNextTTI->up() == endTTI);
+    bool added = false;
 
-    auto newNextIdx = m_pModelTracker->modelCandidate()->index(row, 0, destination);
+    for (auto i = pitem->childrenLowerBound(tl.row()); i && i->modelRow() <= br.row(); i = i->nextSibling()) {
+        auto tti = static_cast<StateTracker::ModelItem*>(i);
 
-    // You cannot move things into an empty model
-    Q_ASSERT((!row) || newNextIdx.isValid());
+        if (!tti->metadata()->viewTracker())
+            continue;
 
-    StateTracker::Index *newNextTTI(nullptr), *newPrevTTI(nullptr);
+        auto it = m_hPendingUpdates.find(tti);
 
-    // Rewind until a next element is found, this happens when destination is empty
-    if (!newNextIdx.isValid() && destination.parent().isValid()) {
-        Q_ASSERT(m_pModelTracker->modelCandidate()->rowCount(destination) == row);
-        auto par = destination.parent();
-        do {
-            if (m_pModelTracker->modelCandidate()->rowCount(par.parent()) > par.row()) {
-                newNextIdx = m_pModelTracker->modelCandidate()->index(par.row(), 0, par.parent());
-                break;
+        if (it == m_hPendingUpdates.end())
+            m_hPendingUpdates.insert(tti, roles);
+        else if (roles.isEmpty())
+            it->clear();
+        else if (!it->isEmpty()) {
+            for (int r : qAsConst(roles)) {
+                if (!it->contains(r))
+                    it->append(r);
             }
+        }
+
+        added = true;
+    }
+
+    if (added)
+        schedulePendingUpdates();
+}
+
+void ContentPrivate::schedulePendingUpdates()
+{
+    const auto w = m_pViewport->modelAdapter()->view()->window();
+
+    // Without a window there is no frame to wait for
+    if (!w) {
+        if (!m_IsFlushScheduled)
+            QTimer::singleShot(0, this, &ContentPrivate::flushPendingUpdates);
+
+        m_IsFlushScheduled = true;
+        return;
+    }
+
+    if (m_pFlushWindow == w)
+        return;
 
-            par = par.parent();
-        } while (par.isValid());
+    if (m_pFlushWindow)
+        disconnect(m_pFlushWindow, &QQuickWindow::afterAnimating,
+            this, &ContentPrivate::flushPendingUpdates);
 
-        newNextTTI = ttiForIndex(newNextIdx);
+    // afterAnimating is emitted from the GUI thread just before the
+    // synchronization with the render thread.
+    m_pFlushWindow = w;
+    connect(w, &QQuickWindow::afterAnimating,
+        this, &ContentPrivate::flushPendingUpdates);
+
+    w->update();
+}
+
+void ContentPrivate::flushPendingUpdates()
+{
+    if (m_pFlushWindow) {
+        disconnect(m_pFlushWindow, &QQuickWindow::afterAnimating,
+            this, &ContentPrivate::flushPendingUpdates);
+        m_pFlushWindow = nullptr;
     }
-    else {
-        newNextTTI = ttiForIndex(newNextIdx);
-        newPrevTTI = newNextTTI ? newNextTTI->up() : nullptr;
+
+    m_IsFlushScheduled = false;
+
+    // The new geometry will be applied once.
+    m_pViewport->s_ptr->beginTransaction();
+
+    // Do not iterate a copy, refreshing an item can cause others to be
+    // destroyed and they are removed from the hash when that happens.
+    while (!m_hPendingUpdates.isEmpty()) {
+        const auto it    = m_hPendingUpdates.begin();
+        const auto tti   = it.key();
+        const auto roles = it.value();
+        m_hPendingUpdates.erase(it);
+
+        if (!tti->metadata()->viewTracker())
+            continue;
+
+        tti->metadata()->contextAdapter()->updateRoles(roles);
+        tti->metadata() << IndexMetadata::ViewAction::UPDATE;
     }
 
-    if (!row) {
-        auto otherI = ttiForIndex(destination);
-        Q_ASSERT((!newPrevTTI) || otherI == newPrevTTI);
+    m_pViewport->s_ptr->commitTransaction();
+}
+
+void ContentPrivate::slotModelReset()
+{
+    m_pViewport->s_ptr->m_Extents.reset(m_pModelTracker->modelCandidate()->rowCount());
+
+    if (auto rc = m_pModelTracker->modelCandidate()->rowCount())
+        slotRowsInserted({}, 0, rc - 1);
+
+    Q_EMIT q_ptr->contentChanged();
+}
+
+void ContentPrivate::snapshotLayout(StateTracker::Index *pitem)
+{
+    if (!pitem->firstChild())
+        return;
+
+    m_hRelayout[pitem] = {
+        pitem->firstChild()->modelRow(), pitem->lastChild()->modelRow()
+    };
+
+    // The model has to keep track of them for the duration of the change
+    for (auto i = pitem->firstChild(); i; i = i->nextSibling()) {
+        restoreIndex(i);
+        snapshotLayout(i);
     }
+}
 
-    // When there is no next element, then the parent has to be extracted manually
-    if (!(newNextTTI || newPrevTTI)) {
-        if (!row)
-            newPrevTTI = ttiForIndex(destination);
-        else {
-            newPrevTTI = ttiForIndex(
-                destination.model()->index(row-1, 0, destination)
-            );
-        }
+/**
+ * Sorting or filtering a proxy model emits layoutChanged. It used to destroy
+ * everything (including the delegates) and load it again from the first row.
+ *
+ * The QPersistentModelIndex of the loaded elements are updated by the model,
+ * so it is enough to remember which rows were loaded before the change.
+ */
+void ContentPrivate::slotLayoutAboutToBeChanged()
+{
+    m_hRelayout.clear();
+    snapshotLayout(m_pRoot);
+}
+
+void ContentPrivate::slotLayoutChanged()
+{
+    // The rows may have been reordered, so the extents are not known anymore
+    m_pViewport->s_ptr->m_Extents.reset(m_pModelTracker->modelCandidate()->rowCount());
+
+    // Nothing was loaded, so there is nothing to preserve
+    if (!m_hRelayout.contains(m_pRoot)) {
+        m_hRelayout.clear();
+        slotModelReset();
+        return;
     }
 
-    StateTracker::ModelItem* newParentTTI = ttiForIndex(destination);
-    Q_ASSERT(newParentTTI || !destination.isValid()); //TODO not coded yet
+    m_pViewport->s_ptr->beginTransaction();
 
-    newParentTTI = newParentTTI ? newParentTTI : m_pRoot;
+    relayout(m_pRoot);
+    m_hRelayout.clear();
 
-    // Remove everything //TODO add batching again
-    StateTracker::Index* tti = endTTI;
-    StateTracker::Index* dest = newNextTTI && newNextTTI->parent() == newParentTTI ?
-        newNextTTI : nullptr;
+    m_pViewport->s_ptr->refreshVisible();
+    m_pViewport->s_ptr->commitTransaction();
 
-    QList<StateTracker::Index*> tmp2;
-    do {
-        tmp2 << tti;
-    } while(endTTI != startTTI && (tti = tti->previousSibling()) != startTTI);
+    _DO_TEST(_test_validateLinkedList, q_ptr)
 
-    if (endTTI != startTTI) //FIXME use a better condition
-        tmp2 << startTTI;
+    Q_EMIT q_ptr->contentChanged();
+}
 
-    Q_ASSERT( (end - start) == tmp2.size() - 1);
+/**
+ * Reorder the loaded children of `pitem` to match the new layout.
+ *
+ * The same number of rows, starting at the same row, stays loaded. The
+ * elements still within this range keep their delegate and context and are
+ * only moved. The others are unloaded and the holes are filled with new
+ * elements. The children are then processed the same way.
+ *
+ * Until the chain is sorted again, the children lookup cannot be used, only
+ * the operations based on the chain position are safe.
+ */
+void ContentPrivate::relayout(StateTracker::Index *pitem)
+{
+    const auto model  = m_pModelTracker->modelCandidate();
+    const auto parent = pitem == m_pRoot ? QModelIndex() : QModelIndex(pitem->index());
+    const auto range  = m_hRelayout.value(pitem);
 
-    // Check if the point where
-    //TODO this isn't good enough
-    bool isRangeVisible = (newPrevTTI &&
-        newPrevTTI->metadata()->modelTracker()->state() == StateTracker::ModelItem::State::VISIBLE) || (newNextTTI &&
-            newNextTTI->metadata()->modelTracker()->state() == StateTracker::ModelItem::State::VISIBLE);
+    const int rc    = model->rowCount(parent);
+    const int count = range.second - range.first + 1;
+    const int first = std::max(0, std::min(range.first, rc - count));
+    const int last  = std::min(rc - 1, first + count - 1);
 
-    const auto topEdge    = q_ptr->edges(EdgeType::VISIBLE)->getEdge(Qt::TopEdge);
-    const auto bottomEdge = q_ptr->edges(EdgeType::VISIBLE)->getEdge(Qt::TopEdge);
+    QVector<StateTracker::Index*> kept, dropped;
 
-    bool needRefreshVisibleTop    = false;
-    bool needRefreshVisibleBottom = false;
-    /*bool needRefreshBufferTop     = false; //TODO lateral move is not implemented
-    bool needRefreshBufferBottom  = false;*/
+    for (auto i = pitem->firstChild(); i; i = i->nextSibling()) {
+        const auto idx = i->index();
 
-    for (auto item : qAsConst(tmp2)) {
-        needRefreshVisibleTop    |= item != topEdge;
-        needRefreshVisibleBottom |= item != bottomEdge;
+        // The rows which were filtered out have an invalid index
+        const bool inRange = idx.isValid() && idx.parent() == parent
+            && idx.row() >= first && idx.row() <= last;
 
-        item->metadata() << IndexMetadata::GeometryAction::MOVE;
+        (inRange ? kept : dropped) << i;
+    }
 
-        item->remove();
+    // DETACH deletes the elements, the chain itself is never iterated
+    for (auto i : qAsConst(dropped))
+        i->metadata()
+            << IndexMetadata::LoadAction::HIDE
+            << IndexMetadata::LoadAction::DETACH;
 
-        StateTracker::Index::insertChildBefore(item, dest, newParentTTI);
+    const auto byRow = [](StateTracker::Index *a, StateTracker::Index *b) {
+        return a->index().row() < b->index().row();
+    };
 
-        Q_ASSERT((!dest) || item->down() == dest);
+    // Re-insert them at the front, from the last to the first. This uses the
+    // same transitions as slotRowsMoved, so the edges follow.
+    if (!std::is_sorted(kept.constBegin(), kept.constEnd(), byRow)) {
+        std::sort(kept.begin(), kept.end(), byRow);
 
-        if (dest)
-            dest->metadata() << IndexMetadata::GeometryAction::MOVE;
+        for (int j = kept.size() - 1; j >= 0; j--) {
+            auto item = kept[j];
 
-        _DO_TEST(_test_validate_edges_simple, q_ptr)
-        m_pViewport->s_ptr->notifyInsert(item->metadata());
+            item->metadata() << IndexMetadata::GeometryAction::MOVE;
+
+            item->remove(true);
 
-        dest = item;
-        if (isRangeVisible) {
-            if (item->metadata()->modelTracker()->state() == StateTracker::ModelItem::State::BUFFER)
-                item->metadata() << IndexMetadata::LoadAction::ATTACH;
+            StateTracker::Index::insertChildBefore(item, nullptr, pitem);
+
+            m_pViewport->s_ptr->notifyInsert(item->metadata());
 
             item->metadata() << IndexMetadata::LoadAction::SHOW;
         }
     }
 
-    _DO_TEST(_test_validate_move, q_ptr, newParentTTI, startTTI, endTTI, newPrevTTI, newNextTTI, row)
+    // Load the rows which were not loaded before the change
+    int k = 0;
+
+    for (int row = first; row <= last;) {
+        if (k < kept.size() && kept[k]->index().row() == row) {
+            row++;
+            k++;
+            continue;
+        }
+
+        const auto before = k < kept.size() ? kept[k] : nullptr;
+        const int  gapEnd = before ? before->index().row() - 1 : last;
+
+        QVector<StateTracker::Index*> chain;
+
+        while (row <= gapEnd)
+            chain << addChildren(model->index(row++, 0, parent));
+
+        StateTracker::Index::insertChildrenBefore(chain, before, pitem);
 
-    resetTemporaryIndices(tmp);
+        for (auto i : qAsConst(chain)) {
+            i->metadata() << IndexMetadata::LoadAction::ATTACH;
 
-    // The visible edges are now probably incorectly placed, reload them
-    if (needRefreshVisibleTop || needRefreshVisibleBottom) {
-        reloadEdges();
-        m_pViewport->s_ptr->refreshVisible();
+            const int crc = model->rowCount(i->index());
+            if (crc && q_ptr->edges(EdgeType::FREE)->m_Edges & Qt::BottomEdge)
+                slotRowsInserted(i->index(), 0, crc - 1);
+        }
     }
 
-    //WARNING The indices still are in transition mode, do not use their value
+    _DO_TEST_IDX(_test_validate_chain, pitem)
+
+    for (auto i : qAsConst(kept)) {
+        if (m_hRelayout.contains(i))
+            relayout(i);
+    }
 }
 
-QList<StateTracker::Index*> ContentPrivate::setTemporaryIndices(const QModelIndex &parent, int start, int end,
+/**
+ * Move the loaded part of the [start, end] range to its new position.
+ *
+ * Only the loaded elements of the range are visited and they are always a
+ * continuous segment of the source chain. If the destination is next to (or
+ * within) the loaded children of the destination parent, the segment keeps
+ * its delegates and is spliced there. Otherwise it leaves the loaded area and
+ * is unloaded like a removal. When the loaded segment is only a part of the
+ * range, splicing it would leave a hole at the destination, so it is
+ * unloaded and the destination rows are loaded once the move is done (see
+ * slotLoadMovedRows).
+ *
+ * This is called from rowsAboutToBeMoved, so all lookups have to be done
+ * before the chain is modified. The rows are only updated by the model
+ * after this returns.
+ */
+void ContentPrivate::slotRowsMoved(const QModelIndex &parent, int start, int end,
                                      const QModelIndex &destination, int row)
 {
-    //FIXME This exists but for now ignoring it hasn't caused too many problems
-    if (parent != destination) {
-        qWarning() << "setTemporaryIndices called with corrupted arguments";
-        return {};
+    Q_ASSERT((!parent.isValid()) || parent.model() == m_pModelTracker->modelCandidate());
+    Q_ASSERT((!destination.isValid()) || destination.model() == m_pModelTracker->modelCandidate());
+
+    m_LoadMovedRows = false;
+
+    // There is literally nothing to do
+    if (parent == destination && start == row)
+        return;
+
+    const auto spitem = parent.isValid()      ? ttiForIndex(parent)      : m_pRoot;
+    const auto dpitem = destination.isValid() ? ttiForIndex(destination) : m_pRoot;
+
+    // Whatever has to be done only affect a part that's not currently tracked.
+    if ((!spitem) && !dpitem)
+        return;
+
+    // The rows between the source and destination are about to change, let
+    // the model update them.
+    if (m_LightCount) {
+        restoreChildren(spitem);
+        restoreChildren(dpitem);
     }
 
-    QList<StateTracker::Index*> ret;
+    const int  count    = end - start + 1;
+    const bool isSame   = parent == destination;
+    const auto isMoved  = [isSame, start, end](StateTracker::Index *i) {
+        return isSame && i->modelRow() >= start && i->modelRow() <= end;
+    };
 
-    // Before moving them, set a temporary now/col value because it wont be set
-    // on the index until before endMoveRows is called (but after this
-    // method returns).
+    // The loaded elements of the range, they are always continuous
+    QVector<StateTracker::Index*> moved;
 
-    const auto pitem = parent.isValid() ? m_hMapper.value(parent) : m_pRoot;
+    if (spitem) {
+        for (auto i = spitem->childrenLowerBound(start); i && i->modelRow() <= end; i = i->nextSibling())
+            moved << i;
+    }
 
-    for (int i = start; i <= end; i++) {
-        auto idx = m_pModelTracker->modelCandidate()->index(i, 0, parent);
+    // Find where the range goes in the destination chain
+    StateTracker::Index *next(nullptr), *prev(nullptr);
+    bool isInWindow = false;
 
-        //TODO do not use the hashmap, it is already known
-        auto elem = pitem->childrenLookup(idx);
-        Q_ASSERT(elem);
+    if (dpitem) {
+        next = dpitem->childrenLowerBound(row);
 
-        elem->setTemporaryIndex(
-            destination, row + (i - start), idx.column()
-        );
-        ret << elem;
+        if (next && isMoved(next))
+            next = moved.last()->nextSibling();
+
+        prev = next ? next->previousSibling() : dpitem->lastChild();
+
+        if (prev && isMoved(prev))
+            prev = moved.first()->previousSibling();
+
+        // An empty parent gets the new rows, otherwise the insertion point
+        // has to touch the loaded rows.
+        isInWindow = (prev && prev->modelRow() == row - 1)
+            || (next && next->modelRow() == row)
+            || ((!prev) && (!next) && !m_pModelTracker->modelCandidate()->rowCount(destination));
     }
 
-    for (int i = row; i <= row + (end - start); i++) {
-        auto idx = m_pModelTracker->modelCandidate()->index(i, 0, parent);
+    if (moved.isEmpty() && !isInWindow)
+        return;
 
-        //TODO do not use the hashmap, it is already known
-        auto elem = pitem->childrenLookup(idx);
-        Q_ASSERT(elem);
+    // Load the new rows once they are at their destination
+    m_LoadMovedRows = isInWindow && moved.size() != count;
 
-        elem->setTemporaryIndex(
-            destination, row + (end - start) + 1, idx.column()
-        );
-        ret << elem;
+    if (moved.isEmpty())
+        return;
+
+    // The whole range leaves the loaded area (or would leave a hole)
+    if (m_LoadMovedRows || !isInWindow) {
+        beginRemoval();
+
+        for (auto i : qAsConst(moved))
+            i->metadata()
+                << IndexMetadata::LoadAction::HIDE
+                << IndexMetadata::LoadAction::DETACH;
+
+        commitRemoval();
+
+        return;
+    }
+
+    const int newFirst = (isSame && row > end) ? row - count : row;
+
+    setTemporaryIndices(moved, destination, newFirst - start);
+
+    // Each notifyInsert would otherwise refresh the whole visible area
+    m_pViewport->s_ptr->beginTransaction();
+
+    // Only the elements after the old and new positions are affected, the
+    // rest of the loaded elements keep their geometry.
+    const auto oldNext = moved.last()->nextSibling();
+
+    // The REPARENT transition updates the edges, it needs the neighbors of
+    // each element, so they are removed one by one.
+    for (auto item : qAsConst(moved)) {
+        item->metadata() << IndexMetadata::GeometryAction::MOVE;
+        item->remove(true);
     }
 
-    return ret;
+    StateTracker::Index::insertChildrenBefore(moved, next, dpitem);
+
+    // The edges grow from the existing ones, so it has to be in order
+    for (auto item : qAsConst(moved)) {
+        m_pViewport->s_ptr->notifyInsert(item->metadata());
+        item->metadata() << IndexMetadata::LoadAction::SHOW;
+    }
+
+    if (oldNext)
+        oldNext->metadata() << IndexMetadata::GeometryAction::MOVE;
+
+    if (next && next != oldNext)
+        next->metadata() << IndexMetadata::GeometryAction::MOVE;
+
+    _DO_TEST(_test_validate_edges_simple, q_ptr)
+    _DO_TEST(_test_validate_move, q_ptr, dpitem, moved.first(), moved.last(), prev, next, row)
+
+    resetTemporaryIndices(moved);
+
+    m_pViewport->s_ptr->refreshVisible();
+    m_pViewport->s_ptr->commitTransaction();
+
+    //WARNING The indices still are in transition mode, do not use their value
+}
+
+/**
+ * Load the rows which were moved into the loaded area without their
+ * elements, see slotRowsMoved.
+ */
+void ContentPrivate::slotLoadMovedRows(const QModelIndex &parent, int start, int end,
+                                       const QModelIndex &destination, int row)
+{
+    const int count    = end - start + 1;
+    const int newFirst = (parent == destination && row > end) ? row - count : row;
+
+    // The extents follow the top level rows, loaded or not
+    auto &extents = m_pViewport->s_ptr->m_Extents;
+
+    if ((!parent.isValid()) && !destination.isValid())
+        extents.moveRows(start, end, row);
+    else if (!parent.isValid())
+        extents.removeRows(start, end);
+    else if (!destination.isValid())
+        extents.insertRows(newFirst, newFirst + count - 1);
+
+    if (!m_LoadMovedRows)
+        return;
+
+    m_LoadMovedRows = false;
+
+    slotRowsInserted(destination, newFirst, newFirst + count - 1);
+}
+
+/**
+ * Before moving them, set a temporary row value because it wont be set on the
+ * index until before endMoveRows is called (but after this method returns).
+ *
+ * Only the moved elements are affected. The others keep their relative order
+ * and their rows are only used by the lookup (which is not used until the
+ * move is done).
+ */
+void ContentPrivate::setTemporaryIndices(const QVector<StateTracker::Index*> &moved,
+                                         const QModelIndex &destination, int delta)
+{
+    for (auto elem : qAsConst(moved))
+        elem->setTemporaryIndex(
+            destination, elem->modelRow() + delta, elem->effectiveColumn()
+        );
 }
 
-void ContentPrivate::resetTemporaryIndices(const QList<StateTracker::Index*>& indices)
+void ContentPrivate::resetTemporaryIndices(const QVector<StateTracker::Index*>& indices)
 {
     for (auto i : qAsConst(indices))
         i->resetTemporaryIndex();
@@ -645,69 +1126,37 @@ void StateTracker::Content::resetEdges()
             setEdge((EdgeType)i, nullptr, e);
 }
 
-// Go O(N) for now. Optimize when it becomes a problem (read: soon)
-void ContentPrivate::reloadEdges()
-{
-    //FIXME optimize this
-
-    enum Range : uint16_t {
-        TOP            = 0x0 << 0,
-        BUFFER_TOP     = 0x1 << 0,
-        VISIBLE        = 0x1 << 1,
-        BUFFER_BOTTOM  = 0x1 << 2,
-        BOTTOM         = 0x1 << 3,
-        IS_VISIBLE     = 0x1 << 4,
-        IS_NOT_VISIBLE = 0x1 << 5,
-        IS_BUFFER      = 0x1 << 6,
-        IS_NOT_BUFFER  = 0x1 << 7,
-    };
-
-    Range pos = Range::TOP;
-
-    for (auto item = m_pRoot->firstChild(); item; item = item->down()) {
-        const uint16_t isVisible = item->metadata()->modelTracker()->state() == StateTracker::ModelItem::State::VISIBLE ?
-            IS_VISIBLE : IS_NOT_VISIBLE;
-        const uint16_t isBuffer  = item->metadata()->modelTracker()->state() == StateTracker::ModelItem::State::BUFFER  ?
-            IS_BUFFER : IS_NOT_BUFFER;
-
-        switch(pos | isVisible | isBuffer) {
-            case Range::TOP    | Range::IS_BUFFER:
-                pos = Range::BUFFER_TOP;
-                q_ptr->setEdge(EdgeType::BUFFERED, item, Qt::TopEdge);
-                break;
-            case Range::TOP        | Range::IS_VISIBLE:
-            case Range::BUFFER_TOP | Range::IS_VISIBLE:
-                pos = Range::VISIBLE;
-                q_ptr->setEdge(EdgeType::VISIBLE, item, Qt::TopEdge);
-                break;
-            case Range::VISIBLE | Range::IS_NOT_VISIBLE:
-            case Range::VISIBLE | Range::IS_NOT_BUFFER:
-                q_ptr->setEdge(EdgeType::VISIBLE, item->up(), Qt::BottomEdge);
-                pos = Range::BOTTOM;
-                break;
-            case Range::VISIBLE | Range::IS_NOT_VISIBLE | Range::IS_BUFFER:
-                pos = Range::BUFFER_BOTTOM;
-                break;
-            case Range::VISIBLE | Range::IS_NOT_BUFFER | Range::IS_NOT_VISIBLE:
-                q_ptr->setEdge(EdgeType::BUFFERED, item->up(), Qt::BottomEdge);
-                pos = Range::BOTTOM;
-                break;
-        }
-    }
-}
-
 void ContentPrivate::enterState(IndexMetadata *tti, StateTracker::ModelItem::State s)
 {
     Q_UNUSED(tti);
     Q_UNUSED(s);
-    //TODO count the number of active objects in each states for the "frame" load balancing
 }
 
 void ContentPrivate::leaveState(IndexMetadata *tti, StateTracker::ModelItem::State s)
 {
     Q_UNUSED(tti);
     Q_UNUSED(s);
-    //TODO count the number of active objects in each states for the "frame" load balancing
+}
+
+void ContentPrivate::enterDangling(IndexMetadata *tti, StateTracker::ModelItem::State s)
+{
+    // It is about to be deleted
+    m_hPendingUpdates.remove(static_cast<StateTracker::ModelItem*>(tti->indexTracker()));
+    m_hRelayout.remove(tti->indexTracker());
+
+    enterState(tti, s);
+}
+
+void ContentPrivate::enterReachable(IndexMetadata *tti, StateTracker::ModelItem::State s)
+{
+    dropIndex(tti->indexTracker());
+    enterState(tti, s);
+}
+
+void ContentPrivate::enterMoving(IndexMetadata *tti, StateTracker::ModelItem::State s)
+{
+    restoreIndex(tti->indexTracker());
+    enterState(tti, s);
 }
 
 void ContentPrivate::error(IndexMetadata *, StateTracker::ModelItem::State)
@@ -733,13 +1182,13 @@ StateTracker::Index *StateTracker::Content::lastItem() const
 bool ContentPrivate::isInsertActive(const QModelIndex& p, int first, int last) const
 {
     Q_UNUSED(last) //TODO
-    auto pitem = p.isValid() ? m_hMapper.value(p) : m_pRoot;
+    auto pitem = p.isValid() ? ttiForIndex(p) : m_pRoot;
 
     StateTracker::Index *prev(nullptr);
 
     //FIXME use up()
     if (first && pitem)
-        prev = pitem->childrenLookup(m_pModelTracker->modelCandidate()->index(first-1, 0, p));
+        prev = pitem->childrenLookup(first - 1);
 
     if (first && !prev)
         return false;
@@ -795,16 +1244,61 @@ bool StateTracker::Content::isActive(const QModelIndex& parent, int first, int l
     return true;
 }
 
-/// Add new entries to the mapping
+/**
+ * Discard all loaded elements and start over with the top level `row` at `y`.
+ *
+ * This is used when the viewport jumps far away from the loaded elements.
+ * Loading everything in between would be O(distance) instead of
+ * O(viewport). StateTracker::Model::populate() then loads the rows around it.
+ */
+void StateTracker::Content::jumpTo(int row, qreal y)
+{
+    const auto model = d_ptr->m_pModelTracker->modelCandidate();
+    const auto idx   = model ? model->index(row, 0) : QModelIndex();
+
+    if (!idx.isValid())
+        return;
+
+    d_ptr->m_pViewport->s_ptr->beginTransaction();
+
+    // Like slotRowsRemoved, the children are detached with their parent
+    for (auto i = d_ptr->m_pRoot->firstChild(); i;) {
+        auto next = i->nextSibling();
+
+        i->metadata()
+            << IndexMetadata::LoadAction::HIDE
+            << IndexMetadata::LoadAction::DETACH;
+
+        i = next;
+    }
+
+    Q_ASSERT(!d_ptr->m_pRoot->firstChild());
+
+    auto e = d_ptr->addChildren(idx);
+    StateTracker::Index::insertChildrenBefore({e}, nullptr, d_ptr->m_pRoot);
+
+    // It has no neighbor to be positioned from
+    e->metadata()->setPosition({0.0, y});
+
+    if (e->metadata()->performAction(IndexMetadata::LoadAction::ATTACH))
+        e->metadata() << IndexMetadata::LoadAction::SHOW;
+    else
+        e->metadata() << IndexMetadata::LoadAction::DETACH;
+
+    d_ptr->m_pViewport->s_ptr->refreshVisible();
+    d_ptr->m_pViewport->s_ptr->commitTransaction();
+
+    _DO_TEST(_test_validateLinkedList, this)
+}
+
+/// Create a new entry, the caller then inserts it in the tree
 StateTracker::ModelItem* ContentPrivate::addChildren(const QModelIndex& index)
 {
-    Q_ASSERT(index.isValid() && !m_hMapper.contains(index));
+    Q_ASSERT(index.isValid() && !ttiForIndex(index));
 
-    auto e = new StateTracker::ModelItem(m_pViewport);
+    auto e = m_Items.create(m_pViewport);
     e->setModelIndex(index);
 
-    m_hMapper[index] = e;
-
     return e;
 }
 
@@ -816,12 +1310,17 @@ void ContentPrivate::slotCleanup()
 
     m_pModelTracker << StateTracker::Model::Action::RESET;
 
+    m_hPendingUpdates.clear();
+    m_LightCount = 0;
+
     m_pRoot->metadata()
         << IndexMetadata::LoadAction::HIDE
         << IndexMetadata::LoadAction::DETACH;
 
-    m_hMapper.clear();
-    m_pRoot = new StateTracker::ModelItem(m_pViewport);
+    // Everything was destroyed, give the memory back all at once
+    m_Items.release();
+
+    m_pRoot = m_Items.create(m_pViewport);
 
     // Reset the edges
     for (int i = 0; i < 3; i++)
@@ -833,11 +1332,12 @@ StateTracker::ModelItem* ContentPrivate::ttiForIndex(const QModelIndex& idx) con
     if (!idx.isValid())
         return nullptr;
 
+    // Walk down from the root, each level is an ordered lookup
     const auto parent = (!idx.parent().isValid()) ?
-        m_pRoot : m_hMapper.value(idx.parent());
+        m_pRoot : ttiForIndex(idx.parent());
 
     return parent ?
-        static_cast<StateTracker::ModelItem*>(parent->childrenLookup(idx)) : nullptr;
+        static_cast<StateTracker::ModelItem*>(parent->childrenLookup(idx.row())) : nullptr;
 }
 
 IndexMetadata *StateTracker::Content::metadataForIndex(const QModelIndex& idx) const
@@ -930,20 +1430,29 @@ QModelIndex ContentPrivate::getNextIndex(const QModelIndex& idx) const
 
 void StateTracker::Content::connectModel(QAbstractItemModel *m)
 {
+    d_ptr->m_pViewport->s_ptr->m_Extents.reset(m->rowCount());
+
+    // The rows have to be shifted first, slotRowsInserted uses them
+    QObject::connect(m, &QAbstractItemModel::rowsInserted, d_ptr,
+        &ContentPrivate::slotShiftInserted);
     QObject::connect(m, &QAbstractItemModel::rowsInserted, d_ptr,
         &ContentPrivate::slotRowsInserted );
     QObject::connect(m, &QAbstractItemModel::rowsAboutToBeRemoved, d_ptr,
         &ContentPrivate::slotRowsRemoved  );
+    QObject::connect(m, &QAbstractItemModel::rowsRemoved, d_ptr,
+        &ContentPrivate::slotShiftRemoved );
     QObject::connect(m, &QAbstractItemModel::layoutAboutToBeChanged, d_ptr,
-        &ContentPrivate::slotCleanup);
+        &ContentPrivate::slotLayoutAboutToBeChanged);
     QObject::connect(m, &QAbstractItemModel::layoutChanged, d_ptr,
         &ContentPrivate::slotLayoutChanged);
     QObject::connect(m, &QAbstractItemModel::modelAboutToBeReset, d_ptr,
         &ContentPrivate::slotCleanup);
     QObject::connect(m, &QAbstractItemModel::modelReset, d_ptr,
-        &ContentPrivate::slotLayoutChanged);
+        &ContentPrivate::slotModelReset);
     QObject::connect(m, &QAbstractItemModel::rowsAboutToBeMoved, d_ptr,
         &ContentPrivate::slotRowsMoved);
+    QObject::connect(m, &QAbstractItemModel::rowsMoved, d_ptr,
+        &ContentPrivate::slotLoadMovedRows);
     QObject::connect(m, &QAbstractItemModel::dataChanged, d_ptr,
         &ContentPrivate::slotDataChanged);
 
@@ -957,20 +1466,26 @@ void StateTracker::Content::connectModel(QAbstractItemModel *m)
 
 void StateTracker::Content::disconnectModel(QAbstractItemModel *m)
 {
+    QObject::disconnect(m, &QAbstractItemModel::rowsInserted, d_ptr,
+        &ContentPrivate::slotShiftInserted);
     QObject::disconnect(m, &QAbstractItemModel::rowsInserted, d_ptr,
         &ContentPrivate::slotRowsInserted);
     QObject::disconnect(m, &QAbstractItemModel::rowsAboutToBeRemoved, d_ptr,
         &ContentPrivate::slotRowsRemoved);
+    QObject::disconnect(m, &QAbstractItemModel::rowsRemoved, d_ptr,
+        &ContentPrivate::slotShiftRemoved);
     QObject::disconnect(m, &QAbstractItemModel::layoutAboutToBeChanged, d_ptr,
-        &ContentPrivate::slotCleanup);
+        &ContentPrivate::slotLayoutAboutToBeChanged);
     QObject::disconnect(m, &QAbstractItemModel::layoutChanged, d_ptr,
         &ContentPrivate::slotLayoutChanged);
     QObject::disconnect(m, &QAbstractItemModel::modelAboutToBeReset, d_ptr,
         &ContentPrivate::slotCleanup);
     QObject::disconnect(m, &QAbstractItemModel::modelReset, d_ptr,
-        &ContentPrivate::slotLayoutChanged);
+        &ContentPrivate::slotModelReset);
     QObject::disconnect(m, &QAbstractItemModel::rowsAboutToBeMoved, d_ptr,
         &ContentPrivate::slotRowsMoved);
+    QObject::disconnect(m, &QAbstractItemModel::rowsMoved, d_ptr,
+        &ContentPrivate::slotLoadMovedRows);
     QObject::disconnect(m, &QAbstractItemModel::dataChanged, d_ptr,
         &ContentPrivate::slotDataChanged);
 
@@ -991,12 +1506,44 @@ void StateTracker::Content::resetRoot()
 {
     root()->metadata() << IndexMetadata::LoadAction::RESET;
 
+    d_ptr->m_hPendingUpdates.clear();
+    d_ptr->m_LightCount = 0;
+
     for (int i = 0; i < 3; i++)
         d_ptr->m_lRects[i] = {};
 
-    d_ptr->m_hMapper.clear();
-    delete d_ptr->m_pRoot;
-    d_ptr->m_pRoot = new StateTracker::ModelItem(d_ptr->m_pViewport);
+    // RESET doesn't unload the elements, they used to be leaked
+    d_ptr->destroyTree(d_ptr->m_pRoot);
+    d_ptr->m_Items.release();
+
+    d_ptr->m_pRoot = d_ptr->m_Items.create(d_ptr->m_pViewport);
+}
+
+void StateTracker::Content::destroyItem(StateTracker::ModelItem *item)
+{
+    d_ptr->m_Items.destroy(item);
+}
+
+/**
+ * Drop or restore the QPersistentModelIndex of a loaded element.
+ *
+ * This does nothing unless the LightweightIndices mode is used.
+ */
+void StateTracker::Content::setLightweight(StateTracker::Index *i, bool value)
+{
+    if (value)
+        d_ptr->dropIndex(i);
+    else
+        d_ptr->restoreIndex(i);
+}
+
+/// Free a subtree without going through the state machine, children first
+void ContentPrivate::destroyTree(StateTracker::ModelItem *item)
+{
+    while (auto c = item->lastChild())
+        destroyTree(static_cast<StateTracker::ModelItem*>(c));
+
+    m_Items.destroy(item);
 }
 
 void StateTracker::Content::perfromStateChange(Event e, IndexMetadata *md, StateTracker::ModelItem::State s)
@@ -1014,7 +1561,7 @@ void StateTracker::Content::forceInsert(const QModelIndex& idx)
 // Also make sure not to load the same element twice
 void StateTracker::Content::forceInsert(const QModelIndex& parent, int first, int last)
 {
-    auto parNode = parent.isValid() ? d_ptr->m_hMapper[parent] : d_ptr->m_pRoot;
+    auto parNode = parent.isValid() ? d_ptr->ttiForIndex(parent) : d_ptr->m_pRoot;
 
     // If the parent isn't loaded, there is no risk of collision
     if (!parNode) {
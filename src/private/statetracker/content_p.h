@@ -71,6 +71,9 @@ public:
     void perfromStateChange(Event e, IndexMetadata *md, StateTracker::ModelItem::State s);
     void forceInsert(const QModelIndex& idx);
     void forceInsert(const QModelIndex& parent, int first, int last);
+    void destroyItem(StateTracker::ModelItem *item);
+    void setLightweight(StateTracker::Index *i, bool value);
+    void jumpTo(int row, qreal y);
 
     // Helpers
     IndexMetadata *metadataForIndex(const QModelIndex& idx) const;
@@ -37,7 +37,7 @@ const StateTracker::Geometry::StateF StateTracker::Geometry::m_fStateMachine[5][
 /*SIZE     */ { A nothing   , A dropSize , A nothing  , A dropSize  , A nothing   , A nothing  , A error     },
 /*POSITION */ { A invalidate, A nothing  , A nothing  , A dropPos   , A nothing   , A nothing  , A error     },
 /*PENDING  */ { A nothing   , A nothing  , A nothing  , A invalidate, A invalidate, A nothing  , A buildCache},
-/*VALID    */ { A nothing   , A dropCache, A dropCache, A invalidate, A dropCache , A dropCache, A buildCache},
+/*VALID    */ { A dropCache , A dropCache, A dropCache, A invalidate, A dropCache , A dropCache, A buildCache},
 };
 #undef A
 
@@ -56,12 +56,30 @@ void StateTracker::Geometry::error()
 
 void StateTracker::Geometry::dropCache()
 {
-    //TODO
+    m_HasCache = false;
 }
 
+/**
+ * Every transition out of VALID drops the cache, so it only has to be built
+ * once per VALID "session". The views call decoratedGeometry() many times per
+ * element and per frame, the decorations don't have to be re-applied each time.
+ */
 void StateTracker::Geometry::buildCache()
 {
-    //TODO
+    if (m_HasCache)
+        return;
+
+    m_DecoratedCache = QRectF(m_Position, m_Size);
+
+    const auto topDeco = borderDecoration( Qt::TopEdge    );
+    const auto botDeco = borderDecoration( Qt::BottomEdge );
+    const auto lefDeco = borderDecoration( Qt::LeftEdge   );
+    const auto rigDeco = borderDecoration( Qt::RightEdge  );
+
+    m_DecoratedCache.setHeight(m_DecoratedCache.height() + topDeco + botDeco);
+    m_DecoratedCache.setWidth (m_DecoratedCache.width () + lefDeco + rigDeco);
+
+    m_HasCache = true;
 }
 
 void StateTracker::Geometry::dropSize()
@@ -126,18 +144,12 @@ QRectF StateTracker::Geometry::contentGeometry() const
 
 QRectF StateTracker::Geometry::decoratedGeometry() const
 {
-    //TODO cache this, extend the state machine to have a "really valid" state
-    auto g = rawGeometry();
-
-    const auto topDeco = borderDecoration( Qt::TopEdge    );
-    const auto botDeco = borderDecoration( Qt::BottomEdge );
-    const auto lefDeco = borderDecoration( Qt::LeftEdge   );
-    const auto rigDeco = borderDecoration( Qt::RightEdge  );
+    // Builds the cache if it isn't already
+    rawGeometry();
 
-    g.setHeight(g.height() + topDeco + botDeco);
-    g.setWidth (g.width () + lefDeco + rigDeco);
+    Q_ASSERT(m_HasCache);
 
-    return g;
+    return m_DecoratedCache;
 }
 
 QSizeF StateTracker::Geometry::size() const
@@ -85,6 +85,9 @@ private:
 
     GeoRect<qreal> m_lBorderDecoration;
 
+    QRectF m_DecoratedCache;
+    bool   m_HasCache {false};
+
     typedef void(Geometry::*StateF)();
 
     static const State  m_fStateMap    [5][7];
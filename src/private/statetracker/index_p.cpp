@@ -70,7 +70,7 @@ void StateTracker::Index::insertChildAfter(StateTracker::Index* self, StateTrack
     if (!parent->m_tChildren[FIRST]) {
         Q_ASSERT(!parent->m_tChildren[LAST]);
         Q_ASSERT(!parent->loadedChildrenCount());
-        parent->m_hLookup[self->m_Index] = self;
+        parent->m_lChildren.insertBefore(self, nullptr);
         parent->m_tChildren[FIRST] = parent->m_tChildren[LAST] = self;
         self->m_pParent = parent;
         self->m_LifeCycleState = self->m_MoveToRow != -1 ?
@@ -84,10 +84,9 @@ void StateTracker::Index::insertChildAfter(StateTracker::Index* self, StateTrack
 
     Q_ASSERT(other);
     Q_ASSERT(other->m_pParent == parent);
-    Q_ASSERT(!parent->m_hLookup.contains(self->m_Index));
+    Q_ASSERT(!parent->m_lChildren.contains(self));
 
-    Q_ASSERT(!parent->m_hLookup.values().contains(self));
-    parent->m_hLookup[self->m_Index] = self;
+    parent->m_lChildren.insertAfter(self, other);
     self->m_pParent = parent;
 
     self->m_LifeCycleState = self->m_MoveToRow != -1 ?
@@ -116,12 +115,12 @@ void StateTracker::Index::insertChildBefore(StateTracker::Index* self, StateTrac
     Q_ASSERT(!self->m_pParent);
     Q_ASSERT(parent);
     Q_ASSERT(self->m_LifeCycleState == LifeCycleState::NEW);
-    Q_ASSERT(!parent->m_hLookup.contains(self->m_Index));
+    Q_ASSERT(!parent->m_lChildren.contains(self));
 
     _DO_TEST_IDX(_test_validate_chain, parent)
 
-    Q_ASSERT(!parent->m_hLookup.values().contains(self));
-    parent->m_hLookup[self->m_Index] = self;
+    // When `other` is null, it goes first (if there is already a first child)
+    parent->m_lChildren.insertBefore(self, other ? other : parent->firstChild());
     self->m_pParent = parent;
     self->m_LifeCycleState = self->m_MoveToRow != -1 ?
         LifeCycleState::TRANSITION : LifeCycleState::NORMAL;
@@ -185,7 +184,61 @@ void StateTracker::Index::insertChildBefore(StateTracker::Index* self, StateTrac
     _DO_TEST_IDX(_test_validate_chain, parent)
 }
 
-/// Fix the issues introduced by createGap (does not update m_pParent and m_hLookup)
+/**
+ * Insert a range of new siblings in a single operation.
+ *
+ * The elements are linked together first, then the whole chain is spliced
+ * before `other` (or at the end when `other` is nullptr). This is O(K + log N)
+ * instead of K individual insertions.
+ */
+void StateTracker::Index::insertChildrenBefore(const QVector<Index*>& chain, StateTracker::Index* other, StateTracker::Index* parent)
+{
+    Q_ASSERT(parent);
+    Q_ASSERT(!chain.isEmpty());
+    Q_ASSERT((!other) || other->m_pParent == parent);
+
+    _DO_TEST_IDX(_test_validate_chain, parent)
+
+    const auto prev = other ? other->previousSibling() : parent->lastChild();
+
+    for (int i = 0; i < chain.size(); i++) {
+        const auto self = chain[i];
+
+        Q_ASSERT(!self->m_pParent);
+        Q_ASSERT(self->m_LifeCycleState == LifeCycleState::NEW);
+
+        //Always detach first
+        Q_ASSERT(!self->m_tSiblings[PREVIOUS]);
+        Q_ASSERT(!self->m_tSiblings[NEXT]);
+
+        self->m_pParent = parent;
+        self->m_LifeCycleState = self->m_MoveToRow != -1 ?
+            LifeCycleState::TRANSITION : LifeCycleState::NORMAL;
+
+        self->m_tSiblings[PREVIOUS] = i ? chain[i-1] : prev;
+        self->m_tSiblings[NEXT] = i == chain.size() - 1 ? other : chain[i+1];
+    }
+
+    // The chain is now linked, so the lookup can be built directly from it
+    parent->m_lChildren.insertChainBefore(chain.first(), chain.last(), other);
+
+    if (prev)
+        prev->m_tSiblings[NEXT] = chain.first();
+    else
+        parent->m_tChildren[FIRST] = chain.first();
+
+    if (other)
+        other->m_tSiblings[PREVIOUS] = chain.last();
+    else
+        parent->m_tChildren[LAST] = chain.last();
+
+    for (auto self : qAsConst(chain))
+        StateTracker::Continuity::select(self);
+
+    _DO_TEST_IDX(_test_validate_chain, parent)
+}
+
+/// Fix the issues introduced by createGap (does not update m_pParent and m_lChildren)
 void StateTracker::Index::bridgeGap(StateTracker::Index* first, StateTracker::Index* second)
 {
     // 3 possible case: siblings, first child or last child
@@ -237,6 +290,14 @@ void StateTracker::Index::bridgeGap(StateTracker::Index* first, StateTracker::In
 
         first->m_pParent->m_tChildren[LAST] = first;
         Q_ASSERT((!first) || first->m_pParent->lastChild());
+
+        // Keep the lookup sorted by row, it is searched by row. `first` is
+        // not necessarily the highest row.
+        auto &siblings = first->m_pParent->m_lChildren;
+        if (siblings.contains(first) && siblings.last() != first) {
+            siblings.remove(first);
+            siblings.insertBefore(first, siblings.lowerBound(first->modelRow() + 1));
+        }
 //
 //         //BEGIN test
 //         int count =0;
@@ -245,7 +306,7 @@ void StateTracker::Index::bridgeGap(StateTracker::Index* first, StateTracker::In
 //
 //         Q_ASSERT(first->m_pParent->firstChild());
 //
-//         Q_ASSERT(count == first->m_pParent->m_hLookup.size());
+//         Q_ASSERT(count == first->m_pParent->loadedChildrenCount());
 //         //END test
     }
     else {
@@ -267,15 +328,13 @@ void StateTracker::Index::remove(bool reparent)
     // You can't remove ROOT, so this should always be true
     Q_ASSERT(m_pParent);
 
-    Q_ASSERT(m_pParent->m_hLookup.values().contains(this));
-    const int size = m_pParent->m_hLookup.size();
-    m_pParent->m_hLookup.remove(m_Index);
-    Q_ASSERT(size == m_pParent->m_hLookup.size()+1);
-    Q_ASSERT(!m_pParent->m_hLookup.values().contains(this));
+    Q_ASSERT(m_pParent->m_lChildren.contains(this));
+    m_pParent->m_lChildren.remove(this);
+    Q_ASSERT(!m_pParent->m_lChildren.contains(this));
 
     if (!reparent) {
         Q_ASSERT(!firstChild());
-        Q_ASSERT(m_hLookup.isEmpty());
+        Q_ASSERT(m_lChildren.isEmpty());
     }
 
     const auto oldNext(nextSibling()), oldPrev(previousSibling());
@@ -325,11 +384,14 @@ void StateTracker::Index::remove(bool reparent)
 //         Q_ASSERT(false); //TODO
 //     }
 //     else { //FIXME very wrong
-//         Q_ASSERT(m_pParent->m_hLookup.isEmpty());
+//         Q_ASSERT(m_pParent->m_lChildren.isEmpty());
 //         m_pParent->m_tChildren[FIRST] = nullptr;
 //         m_pParent->m_tChildren[LAST] = nullptr;
 //     }
 
+    // It can be inserted again, possibly as part of a chain
+    m_tSiblings[PREVIOUS] = m_tSiblings[NEXT] = nullptr;
+
     m_LifeCycleState = LifeCycleState::NEW;
     m_pParent = nullptr;
 }
@@ -340,7 +402,7 @@ StateTracker::Index* StateTracker::Index::up() const
 
     // Another simple case, there is no parent
     if (!m_pParent) {
-        Q_ASSERT(!m_Index.parent().isValid()); //TODO remove, no longer true when partial loading is implemented
+        Q_ASSERT(!index().parent().isValid()); //TODO remove, no longer true when partial loading is implemented
 
         return nullptr;
     }
@@ -395,9 +457,9 @@ StateTracker::Index* StateTracker::Index::down() const
     }
 
     // Can't happen, exists to detect corrupted code
-    if (m_Index.parent().isValid()) {
+    if (index().parent().isValid()) {
         Q_ASSERT(m_pParent);
-//         Q_ASSERT(m_pParent->parent()->parent()->m_hLookup.size()
+//         Q_ASSERT(m_pParent->parent()->parent()->loadedChildrenCount()
 //             == m_pParent->m_Index.parent().row()+1);
     }
 
@@ -426,50 +488,68 @@ StateTracker::Index* ModelRect::getEdge(Qt::Edge e) const
 
 StateTracker::Index *StateTracker::Index::childrenLookup(const QPersistentModelIndex &index) const
 {
-    return m_hLookup.value(index);
+    return index.isValid() ? childrenLookup(index.row()) : nullptr;
+}
+
+StateTracker::Index *StateTracker::Index::childrenLookup(int row) const
+{
+    return m_lChildren.find(row);
+}
+
+/// The first loaded child at `row` or after, use nextSibling() to iterate
+StateTracker::Index *StateTracker::Index::childrenLowerBound(int row) const
+{
+    return m_lChildren.lowerBound(row);
 }
 
 bool StateTracker::Index::hasChildren(StateTracker::Index *child) const
 {
-    return !m_hLookup.keys(child).isEmpty();
+    return child && child->m_pParent == this && m_lChildren.contains(child);
 }
 
 int StateTracker::Index::loadedChildrenCount() const
 {
-    return m_hLookup.size();
+    return m_lChildren.size();
 }
 
 QList<StateTracker::Index*> StateTracker::Index::allLoadedChildren() const
 {
-    return m_hLookup.values();
+    QList<StateTracker::Index*> ret;
+    ret.reserve(m_lChildren.size());
+
+    for (auto i = m_lChildren.first(); i; i = SiblingTree::next(i))
+        ret << i;
+
+    return ret;
 }
 
 bool StateTracker::Index::withinRange(QAbstractItemModel* m, int last, int first) const
 {
     // Return true if the previous element or next element are loaded
-    const QModelIndex prev = first ? m->index(first - 1, 0, m_Index) : QModelIndex();
-    const QModelIndex next = first ? m->index(last  + 1, 0, m_Index) : QModelIndex();
+    const auto self    = index();
+    const bool hasPrev = first && m->index(first - 1, 0, self).isValid();
+    const bool hasNext = first && m->index(last  + 1, 0, self).isValid();
 
-    return (prev.isValid() && m_hLookup.contains(prev))
-        || (next.isValid() && m_hLookup.contains(next));
+    return (hasPrev && m_lChildren.find(first - 1))
+        || (hasNext && m_lChildren.find(last  + 1));
 }
 
 int StateTracker::Index::effectiveRow() const
 {
     return m_MoveToRow == -1 ?
-        m_Index.row() : m_MoveToRow;
+        modelRow() : m_MoveToRow;
 }
 
 int StateTracker::Index::effectiveColumn() const
 {
     return m_MoveToColumn == -1 ?
-        m_Index.column() : m_MoveToColumn;
+        (m_pModel ? m_Column : m_Index.column()) : m_MoveToColumn;
 }
 
-QPersistentModelIndex StateTracker::Index::effectiveParentIndex() const
+QModelIndex StateTracker::Index::effectiveParentIndex() const
 {
     return m_LifeCycleState == LifeCycleState::TRANSITION ?
-        m_MoveToParent : m_pParent->index();
+        QModelIndex(m_MoveToParent) : m_pParent->index();
 }
 
 void StateTracker::Index::resetTemporaryIndex()
@@ -497,15 +577,69 @@ void StateTracker::Index::setTemporaryIndex(const QModelIndex& newParent, int ro
     m_LifeCycleState = LifeCycleState::TRANSITION;
 }
 
-QPersistentModelIndex StateTracker::Index::index() const
+QModelIndex StateTracker::Index::index() const
 {
-    return m_Index;
+    if (!m_pModel)
+        return m_Index;
+
+    // Only the root has no parent and it has no index either
+    return m_pModel->index(m_Row, m_Column, m_pParent ? m_pParent->index() : QModelIndex());
 }
 
 void StateTracker::Index::setModelIndex(const QPersistentModelIndex& idx)
 {
     Q_ASSERT(m_LifeCycleState == LifeCycleState::NEW);
-    m_Index = idx;
+    m_Index  = idx;
+    m_pModel = nullptr;
+}
+
+bool StateTracker::Index::hasPersistentIndex() const
+{
+    return !m_pModel;
+}
+
+/// The current row, without taking the move transitions into account
+int StateTracker::Index::modelRow() const
+{
+    return m_pModel ? m_Row : m_Index.row();
+}
+
+/**
+ * The model has to update every QPersistentModelIndex each time rows are
+ * inserted, removed or moved. This gets slower with each tracked element,
+ * even when they are not visible.
+ *
+ * Once dropped, the row is no longer updated by the model. The Content has
+ * to call shiftRow() when the siblings before it change.
+ */
+void StateTracker::Index::dropPersistentIndex()
+{
+    if (m_pModel || !m_Index.isValid())
+        return;
+
+    // Moving elements rely on the model updating them
+    Q_ASSERT(m_LifeCycleState != LifeCycleState::TRANSITION);
+
+    m_Row    = m_Index.row();
+    m_Column = m_Index.column();
+    m_pModel = m_Index.model();
+    m_Index  = QPersistentModelIndex();
+}
+
+void StateTracker::Index::restorePersistentIndex()
+{
+    if (!m_pModel)
+        return;
+
+    m_Index  = index();
+    m_pModel = nullptr;
+    m_Row    = m_Column = -1;
+}
+
+void StateTracker::Index::shiftRow(int delta)
+{
+    Q_ASSERT(m_pModel);
+    m_Row += delta;
 }
 
 int StateTracker::Index::depth() const
@@ -20,9 +20,11 @@
 
 #include <QtCore/QModelIndex>
 #include <QtCore/QList>
+#include <QtCore/QVector>
 
 #include <private/geoutils_p.h>
 #include <private/indexmetadata_p.h>
+#include "siblingtree_p.h"
 
 class Viewport;
 
@@ -46,6 +48,7 @@ class Continuity;
 class Index
 {
     friend class Continuity; //Manage the m_pContinuity
+    friend class SiblingTree; //Manage the m_Node
 public:
     enum class LifeCycleState {
         NEW        , /*!< Not part of a tree yet                              */
@@ -59,6 +62,7 @@ public:
 
     static void insertChildBefore(Index* self, StateTracker::Index* other, StateTracker::Index* parent);
     static void insertChildAfter(Index* self, StateTracker::Index* other, StateTracker::Index* parent);
+    static void insertChildrenBefore(const QVector<Index*>& chain, StateTracker::Index* other, StateTracker::Index* parent);
 
     Index *firstChild() const;
     Index *lastChild () const;
@@ -80,12 +84,14 @@ public:
 
     int effectiveRow() const;
     int effectiveColumn() const;
-    QPersistentModelIndex effectiveParentIndex() const;
+    QModelIndex effectiveParentIndex() const;
 
     virtual void remove(bool reparent = false);
     static void bridgeGap(Index* first, StateTracker::Index* second);
 
     Index *childrenLookup(const QPersistentModelIndex &index) const;
+    Index *childrenLookup(int row) const;
+    Index *childrenLowerBound(int row) const;
     bool hasChildren(Index *child) const;
     int loadedChildrenCount() const;
     QList<Index*> allLoadedChildren() const;
@@ -100,9 +106,16 @@ public:
      */
     bool isNeighbor(Index *other) const;
 
-    QPersistentModelIndex index() const;
+    QModelIndex index() const;
     void setModelIndex(const QPersistentModelIndex& idx);
 
+    // Lightweight row identity
+    bool hasPersistentIndex() const;
+    int modelRow() const;
+    void dropPersistentIndex();
+    void restorePersistentIndex();
+    void shiftRow(int delta);
+
     LifeCycleState lifeCycleState() const {return m_LifeCycleState;}
 
     IndexMetadata *metadata() const;
@@ -134,8 +147,15 @@ private:
     Index* m_pParent {nullptr};
     QPersistentModelIndex m_Index;
 
-    //TODO use a btree, not an hash
-    QHash<QPersistentModelIndex, Index*> m_hLookup;
+    // When the QPersistentModelIndex is dropped, the element is addressed
+    // using its parent and row. The Content keeps the row up to date.
+    const QAbstractItemModel *m_pModel {nullptr};
+    int m_Row    {-1};
+    int m_Column {-1};
+
+    // Ordered lookup of the loaded children and this element node
+    SiblingTree m_lChildren;
+    SiblingTree::Node m_Node;
     mutable IndexMetadata m_Geometry;
     Continuity *m_pContinuity {nullptr};
 };
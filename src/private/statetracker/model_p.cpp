@@ -18,15 +18,25 @@
 #include "model_p.h"
 
 #include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QTimer>
+#include <QQuickWindow>
 
 #include <private/indexmetadata_p.h>
 #include <private/statetracker/content_p.h>
 #include <private/statetracker/index_p.h>
+#include <private/viewport_p.h>
+#include <adapters/modeladapter.h>
+#include <viewport.h>
+#include <viewbase.h>
 
 using EdgeType = IndexMetadata::EdgeType;
 
 #include <QtGlobal>
 
+// LibStdC++
+#include <algorithm>
+
 #define S StateTracker::Model::State::
 const StateTracker::Model::State StateTracker::Model::m_fStateMap[6][7] = {
 /*                POPULATE     DISABLE       ENABLE       RESET         FREE         MOVE         TRIM   */
@@ -138,44 +148,107 @@ void StateTracker::Model::populate()
     const auto s = m_State;
     m_State = State::MUTATING;
 
+    const auto vp = q_ptr->root()->metadata()->viewport();
+
+    // Start from the tail, the other rows are then loaded upward until the
+    // viewport is full. The head of the model is never visited.
+    if ((!q_ptr->root()->firstChild()) && vp->s_ptr->isBottomAnchored()) {
+        if (const int rc = m_pModel->rowCount())
+            q_ptr->jumpTo(rc - 1, 0.0);
+    }
+
+    // Creating the delegates is by far the most expensive part. When there
+    // is a budget, stop once it is spent and continue on the next frame.
+    const int budget = vp->modelAdapter()->loadingBudget();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Loading everything at once ignores the budget. Only seed the first row
+    // and let the loop below (and the next frames) create the others.
+    if (budget && (!q_ptr->root()->firstChild()) && m_pModel->rowCount())
+        q_ptr->forceInsert({}, 0, 0);
+
     if (q_ptr->root()->firstChild() && (q_ptr->edges(EdgeType::FREE)->m_Edges & (Qt::TopEdge|Qt::BottomEdge))) {
-        while (q_ptr->edges(EdgeType::FREE)->m_Edges & Qt::TopEdge) {
-            const auto was = q_ptr->edges(EdgeType::VISIBLE)->getEdge(Qt::TopEdge);
-            //FIXME when everything fails to load, it would otherwise make an infinite loop
-            if (!was)
-                break;
+        // The edges which can't load anything else
+        Qt::Edges done;
+
+        // A model can always have more rows to fetch. Fetch at most once per
+        // pass, the next batch is requested when populating again.
+        bool fetched = false;
+
+        const auto rect = vp->currentRect();
 
-            const auto u = was->metadata()->modelTracker()->load(Qt::TopEdge);
+        // How far the end of the loaded range is from the viewport
+        const auto distance = [this, &rect](Qt::Edge e) -> qreal {
+            const auto i = q_ptr->edges(EdgeType::BUFFERED)->getEdge(e);
 
-            Q_ASSERT(u || q_ptr->edges(EdgeType::VISIBLE)->getEdge(Qt::TopEdge)->effectiveRow() == 0);
-            Q_ASSERT(u || !q_ptr->edges(EdgeType::VISIBLE)->getEdge(Qt::TopEdge)->effectiveParentIndex().isValid());
+            if ((!i) || !i->metadata()->isValid())
+                return 0;
 
-            if (!u)
+            const auto geo = i->metadata()->decoratedGeometry();
+
+            return e == Qt::TopEdge ? rect.y() - geo.y() : geo.bottom() - rect.bottom();
+        };
+
+        while (const auto free = q_ptr->edges(EdgeType::FREE)->m_Edges & ~done & (Qt::TopEdge|Qt::BottomEdge)) {
+            if (budget && timer.elapsed() >= budget) {
+                deferPopulate();
                 break;
+            }
 
-            u->metadata() << IndexMetadata::LoadAction::SHOW;
-        }
+            // Load the row closest to the viewport first, so the visible
+            // rows are created first when the budget runs out.
+            const auto e = free == (Qt::TopEdge|Qt::BottomEdge) ? (
+                distance(Qt::TopEdge) <= distance(Qt::BottomEdge) ? Qt::TopEdge : Qt::BottomEdge
+            ) : (free & Qt::TopEdge ? Qt::TopEdge : Qt::BottomEdge);
 
-        while (q_ptr->edges(EdgeType::FREE)->m_Edges & Qt::BottomEdge) {
-            const auto was = q_ptr->edges(EdgeType::VISIBLE)->getEdge(Qt::BottomEdge);
+            // Load from the ends of the loaded range, not the visible one,
+            // the buffer is part of what has to be filled.
+            const auto was = q_ptr->edges(EdgeType::BUFFERED)->getEdge(e);
 
             //FIXME when everything fails to load, it would otherwise make an infinite loop
-            if (!was)
-                break;
+            if (!was) {
+                done |= e;
+                continue;
+            }
 
-            const auto u = was->metadata()->modelTracker()->load(Qt::BottomEdge);
+            const auto u = was->metadata()->modelTracker()->load(e);
 
-            if (!u)
-                break;
+            Q_ASSERT(u || e != Qt::TopEdge || q_ptr->edges(EdgeType::BUFFERED)->getEdge(Qt::TopEdge)->effectiveRow() == 0);
+            Q_ASSERT(u || e != Qt::TopEdge || !q_ptr->edges(EdgeType::BUFFERED)->getEdge(Qt::TopEdge)->effectiveParentIndex().isValid());
+
+            if (!u) {
+                // The model may only expose the rows it already fetched
+                if (e == Qt::BottomEdge && !fetched) {
+                    fetched = true;
+
+                    if (fetchMore(0))
+                        continue;
+                }
+
+                done |= e;
+                continue;
+            }
+
+            // ModelItem::attach() decides if it goes in the buffer or
+            // is directly shown.
+            const auto st = u->metadata()->modelTracker()->state();
+
+            if (st != StateTracker::ModelItem::State::BUFFER && st != StateTracker::ModelItem::State::VISIBLE)
+                u->metadata() << IndexMetadata::LoadAction::SHOW;
 
-            u->metadata() << IndexMetadata::LoadAction::SHOW;
+            // The delegate failed to load, don't try it again forever
+            if (q_ptr->edges(EdgeType::BUFFERED)->getEdge(e) == was)
+                done |= e;
         }
     }
     else if (auto rc = m_pModel->rowCount()) {
-
-        //TODO support anchors (load from the bottom)
         q_ptr->forceInsert({}, 0, rc - 1);
-
+    }
+    else if (fetchMore(0) && !q_ptr->root()->firstChild()) {
+        // When the model is tracked, the new rows are already loaded
+        q_ptr->forceInsert({}, 0, m_pModel->rowCount() - 1);
     }
 
     //HACK Restore the stashed state
@@ -186,67 +259,267 @@ void StateTracker::Model::populate()
     }
 }
 
+/**
+ * Continue populating on the next frame (see ModelAdapter::loadingBudget).
+ *
+ * QQuickWindow::afterAnimating is emitted once per frame, before the scene
+ * graph is synchronized. This gives the window a chance to render what has
+ * been created so far. When the view is not in a window yet, continue once
+ * the event loop is idle.
+ */
+void StateTracker::Model::deferPopulate()
+{
+    if (m_FrameConnection || m_IsPopulateScheduled)
+        return;
+
+    const auto w = q_ptr->root()->metadata()->viewport()->modelAdapter()->view()->window();
+
+    // Without a window there is no frame to wait for
+    if (!w) {
+        m_IsPopulateScheduled = true;
+
+        QTimer::singleShot(0, q_ptr, [this]() {
+            m_IsPopulateScheduled = false;
+            this << StateTracker::Model::Action::MOVE;
+        });
+
+        return;
+    }
+
+    m_FrameConnection = QObject::connect(w, &QQuickWindow::afterAnimating, q_ptr, [this]() {
+        QObject::disconnect(m_FrameConnection);
+        m_FrameConnection = {};
+
+        this << StateTracker::Model::Action::MOVE;
+    });
+
+    w->update();
+}
+
+/**
+ * Unload the elements which are more than `cacheBuffer` elements away from
+ * the viewport. The elements within `cacheBufferHeight` pixels of the
+ * viewport are also kept (see Viewport::bufferRect).
+ *
+ * Only the ends of the loaded range can be unloaded, otherwise there would be
+ * holes in the tree. An element can only be unloaded once it has no loaded
+ * children. At the bottom, the children always go first. At the top, the
+ * parent is above its children, so it stays until they are all gone, but
+ * its first children are unloaded. So for trees, only the ancestors of the
+ * loaded elements are kept beyond the buffer. With LightweightIndices, they
+ * are the only elements without a QPersistentModelIndex.
+ *
+ * The position of the remaining elements doesn't depend on the unloaded ones,
+ * so nothing has to be moved. When they are loaded again, they are
+ * positioned from the element below them (see IndexMetadata::sizeHint).
+ *
+ * Only the elements outside of the viewport are visited, so this is
+ * O(buffer + trimmed).
+ */
 void StateTracker::Model::trim()
 {
-    //FIXME For now the delegates are only freed when the QModelIndex is removed.
-    // This also prevent pooling from being used/finished.
-    return;
-
-//     QTimer::singleShot(0, [this]() {
-//         if (m_TrackingState != StateTracker::Content::TrackingState::TRACKING)
-//             return;
-//
-//         _test_validateViewport();
-//
-//         qDebug() << "TRIM" << edges(EdgeType::VISIBLE)->m_Edges;
-//     //     if (!edges(EdgeType::FREE)->getEdge(Qt::TopEdge)) {
-//     //         Q_ASSERT(!edges(EdgeType::FREE)->getEdge(Qt::BottomEdge));
-//     //         return;
-//     //     }
-//
-//         auto elem = TTI(edges(EdgeType::VISIBLE)->getEdge(Qt::TopEdge)); //FIXME have a visual and reacheable rect
-//
-//         while (!(edges(EdgeType::FREE)->m_Edges & Qt::TopEdge)) {
-//             Q_ASSERT(elem);
-//             Q_ASSERT(edges(EdgeType::FREE)->getEdge(Qt::TopEdge));
-//             Q_ASSERT(!m_pViewport->currentRect().intersects(elem->metadata()->geometry()));
-//
-//             elem->metadata() << IndexMetadata::LoadAction::HIDE);
-//             elem = TTI(edges(EdgeType::VISIBLE)->getEdge(Qt::TopEdge));
-//         }
-//
-//         elem = TTI(edges(EdgeType::VISIBLE)->getEdge(Qt::BottomEdge)); //FIXME have a visual and reacheable rect
-//         while (!(edges(EdgeType::FREE)->m_Edges & Qt::BottomEdge)) {
-//             Q_ASSERT(elem);
-//             Q_ASSERT(!m_pViewport->currentRect().intersects(elem->metadata()->geometry()));
-//             elem->metadata() << IndexMetadata::LoadAction::HIDE);
-//             elem = TTI(edges(EdgeType::VISIBLE)->getEdge(Qt::BottomEdge));
-//         }
-//     });
-
-
-    // Unload everything below the cache area to get rid of the insertion/moving
-    // overhead. Not doing so would also require to handle "holes" in the tree
-    // which is very complex and unnecessary.
-    StateTracker::Index *be = q_ptr->edges(EdgeType::VISIBLE)->getEdge(Qt::BottomEdge); //TODO use BUFFERED
-
-    if (!be)
+    // Unloading causes the viewport to update its edges, which trims again
+    if (m_IsTrimming || !m_pModel)
         return;
 
-    StateTracker::Index *item = q_ptr->lastItem();
+    const auto vp     = q_ptr->root()->metadata()->viewport();
+    const int  buffer = vp->modelAdapter()->cacheBuffer();
+    const auto rect   = vp->currentRect();
+    const auto zone   = vp->s_ptr->bufferRect();
+
+    if (!rect.isValid())
+        return;
+
+    QVector<IndexMetadata*> above, below;
+
+    for (auto i = q_ptr->firstItem(); i; i = i->down()) {
+        if ((!i->metadata()->isValid()) || i->metadata()->decoratedGeometry().bottom() > rect.y())
+            break;
 
-    if (be == item)
+        above << i->metadata();
+    }
+
+    for (auto i = q_ptr->lastItem(); i; i = i->up()) {
+        if ((!i->metadata()->isValid()) || i->metadata()->decoratedGeometry().y() < rect.bottom())
+            break;
+
+        below << i->metadata();
+    }
+
+    if (above.size() <= buffer && below.size() <= buffer)
         return;
 
+    m_IsTrimming = true;
+    vp->s_ptr->beginTransaction();
+
+    // Both are sorted from the furthest to the closest element
+    for (auto l : {&above, &below}) {
+        for (int j = 0; j < l->size() - buffer; j++) {
+            const auto md = (*l)[j];
+
+            // Keep the parents of loaded elements, but unload their first
+            // children. The next children are then positioned from the ones
+            // below (see IndexMetadata::isAfterGap). Outside of the buffer,
+            // the parents don't need a QPersistentModelIndex.
+            if (md->indexTracker()->firstChild()) {
+                q_ptr->setLightweight(
+                    md->indexTracker(), !md->decoratedGeometry().intersects(zone)
+                );
+                continue;
+            }
+
+            // The rest of the list is even closer to the viewport
+            if (md->decoratedGeometry().intersects(zone))
+                break;
+
+            md  << IndexMetadata::LoadAction::HIDE
+                << IndexMetadata::LoadAction::DETACH;
+        }
+    }
+
+    vp->s_ptr->commitTransaction();
+    m_IsTrimming = false;
+}
+
+/**
+ * When the viewport moved far away from the loaded elements (like dragging
+ * the scrollbar), start over at the row which is now at the top of the
+ * viewport instead of loading everything in between.
+ *
+ * The row and its position are estimated from the extents of the rows which
+ * have been loaded so far (see RowExtents).
+ */
+bool StateTracker::Model::jump()
+{
+    const auto vp    = q_ptr->root()->metadata()->viewport();
+    const auto rect  = vp->currentRect();
+    const auto first = q_ptr->firstItem();
+    const auto last  = q_ptr->lastItem ();
+
+    if ((!rect.isValid()) || (!first) || (!last))
+        return false;
+
+    if (!(first->metadata()->isValid() && last->metadata()->isValid()))
+        return false;
+
+    const qreal top    = first->metadata()->decoratedGeometry().y();
+    const qreal bottom = last->metadata()->decoratedGeometry().bottom();
+
+    // When it is close, loading the rows in between is cheaper. They would be
+    // part of the buffer anyway.
+    if (std::max(top - rect.bottom(), rect.y() - bottom) <= rect.height())
+        return false;
+
+    const int row = vp->s_ptr->rowAt(rect.y());
+
+    if (row < 0)
+        return false;
+
+    // It has to be computed before the anchors are unloaded
+    const qreal y = vp->s_ptr->rowPosition(row);
+
+    const auto s = m_State;
+    m_State = State::MUTATING;
+
+    q_ptr->jumpTo(row, y);
+
+    m_State = s;
+
+    return true;
+}
+
+/**
+ * Ask the model for more rows (see QAbstractItemModel::fetchMore).
+ *
+ * Models such as QSqlQueryModel only report the rows they already fetched.
+ * When the last loaded element is also the last row of its parent, the
+ * parent (or one of its ancestors) may have more to give.
+ *
+ * The rows are fetched when fewer than `distance` pixels of rows are left
+ * after the last loaded element, or when it is the last one if `distance`
+ * is 0.
+ *
+ * @return If rows were added
+ */
+bool StateTracker::Model::fetchMore(qreal distance)
+{
+    // Fetching inserts rows, which will populate the view again
+    if (m_IsFetching || !m_pModel)
+        return false;
+
+    const auto bbe = q_ptr->edges(EdgeType::BUFFERED)->getEdge(Qt::BottomEdge);
+    const auto vp  = q_ptr->root()->metadata()->viewport();
+
+    const qreal extent = vp->s_ptr->m_Extents.estimatedExtent();
+
+    QModelIndex parent;
+    QModelIndex idx = bbe ? bbe->index() : QModelIndex();
+
+    // Find the closest ancestor which has nothing else to show
     do {
-        item->metadata() << IndexMetadata::LoadAction::DETACH;
-    } while((item = item->up()) != be);
+        parent = idx.parent();
+
+        const int remaining = m_pModel->rowCount(parent) - (idx.isValid() ? idx.row() + 1 : 0);
+
+        // Until a row is measured, the distance can't be converted to rows
+        const bool isClose = remaining == 0
+            || (extent > 0 && remaining * extent < distance);
+
+        if (m_pModel->canFetchMore(parent) && isClose)
+            break;
+
+        // There is still something to load before reaching the end
+        if (remaining)
+            return false;
+
+        idx = parent;
+    } while (idx.isValid());
+
+    if (!m_pModel->canFetchMore(parent))
+        return false;
+
+    const int count = m_pModel->rowCount(parent);
+
+    m_IsFetching = true;
+    m_pModel->fetchMore(parent);
+    m_IsFetching = false;
+
+    // When nothing was added, don't try again, it would never end
+    return m_pModel->rowCount(parent) > count;
+}
+
+/**
+ * How far (in pixels) the inertia will still scroll toward the end.
+ *
+ * The velocity decreases geometrically (see Flickable::flickDeceleration).
+ */
+qreal StateTracker::Model::flickDistance() const
+{
+    const auto view = q_ptr->root()->metadata()->viewport()->modelAdapter()->view();
+
+    if (!view)
+        return 0;
+
+    const qreal v     = view->verticalVelocity();
+    const qreal decel = view->flickDeceleration();
+
+    if (v <= 0 || decel <= 0 || decel >= 1)
+        return 0;
+
+    return v * decel / (1 - decel);
 }
 
 void StateTracker::Model::fill()
 {
-    trim();
+    // Nothing is left to trim after a jump
+    if (!jump())
+        trim();
+
     populate();
+
+    // Prefetch the next page before the flick reaches the end
+    if (const qreal distance = flickDistance())
+        fetchMore(distance);
 }
 
 void StateTracker::Model::nothing()
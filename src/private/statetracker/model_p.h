@@ -18,6 +18,7 @@
 #ifndef KQUICKITEMVIEWS_MODEL_P_H
 #define KQUICKITEMVIEWS_MODEL_P_H
 
+#include <QtCore/QMetaObject>
 
 class QAbstractItemModel;
 
@@ -67,6 +68,10 @@ private:
     State m_State {State::NO_MODEL};
     QAbstractItemModel* m_pModel        {nullptr};
     QAbstractItemModel* m_pTrackedModel {nullptr};
+    bool                m_IsTrimming    { false };
+    bool                m_IsFetching    { false };
+    bool                m_IsPopulateScheduled { false };
+    QMetaObject::Connection m_FrameConnection;
 
     // Actions, do not call directly
     void track();
@@ -79,6 +84,12 @@ private:
     void fill();
     void trim();
 
+    // Helpers
+    bool jump();
+    void deferPopulate();
+    bool fetchMore(qreal distance);
+    qreal flickDistance() const;
+
     static const State  m_fStateMap    [6][7];
     static const StateF m_fStateMachine[6][7];
 
@@ -90,19 +90,21 @@ StateTracker::ModelItem* StateTracker::ModelItem::load(Qt::Edge e) const
 void StateTracker::ModelItem::rebuildState()
 {
     static const auto VISIBLE = StateTracker::ModelItem::State::VISIBLE;
+    static const auto MOVING  = StateTracker::ModelItem::State::MOVING;
 
     //TODO make a 3D matrix out of this
     auto u = up  () ? up  ()->metadata()->modelTracker() : nullptr;
     auto d = down() ? down()->metadata()->modelTracker() : nullptr;
 
-    const bool betweenVis = u && d && u->state() == VISIBLE && d->state() == VISIBLE;
-    const bool nearVisible = ((!u) && d && d->state() == VISIBLE) ||
-        ((!d) && u && u->state() == VISIBLE);
+    // When a range is moved, its elements are inserted at once and become
+    // visible one by one. The first one decides for the others.
+    const bool nextToVisible = (u && u->state() == VISIBLE) || (d && d->state() == VISIBLE);
+    const bool inMovedRange  = (u && u->state() == MOVING ) || (d && d->state() == MOVING );
 
-    if (betweenVis || nearVisible)
+    if (nextToVisible || inMovedRange || ((!u) && !d))
         m_State = StateTracker::ModelItem::State::VISIBLE;
     else
-        Q_ASSERT(false); //TODO not implemented
+        m_State = StateTracker::ModelItem::State::BUFFER;
 }
 
 IndexMetadata::EdgeType StateTracker::ModelItem::isTopEdge() const
@@ -111,11 +113,11 @@ IndexMetadata::EdgeType StateTracker::ModelItem::isTopEdge() const
 
     const auto r = metadata()->viewport()->s_ptr->m_pReflector;
 
-    if (r->getEdge(IndexMetadata::EdgeType::VISIBLE, Qt::TopEdge)) {
+    if (r->getEdge(IndexMetadata::EdgeType::VISIBLE, Qt::TopEdge) == metadata()) {
         return IndexMetadata::EdgeType::VISIBLE;
     }
 
-    if (r->getEdge(IndexMetadata::EdgeType::VISIBLE, Qt::TopEdge)) {
+    if (r->getEdge(IndexMetadata::EdgeType::BUFFERED, Qt::TopEdge) == metadata()) {
         return IndexMetadata::EdgeType::BUFFERED;
     }
 
@@ -128,11 +130,11 @@ IndexMetadata::EdgeType StateTracker::ModelItem::isBottomEdge() const
 
     const auto r = metadata()->viewport()->s_ptr->m_pReflector;
 
-    if (r->getEdge(IndexMetadata::EdgeType::VISIBLE, Qt::BottomEdge)) {
+    if (r->getEdge(IndexMetadata::EdgeType::VISIBLE, Qt::BottomEdge) == metadata()) {
         return IndexMetadata::EdgeType::VISIBLE;
     }
 
-    if (r->getEdge(IndexMetadata::EdgeType::VISIBLE, Qt::BottomEdge)) {
+    if (r->getEdge(IndexMetadata::EdgeType::BUFFERED, Qt::BottomEdge) == metadata()) {
         return IndexMetadata::EdgeType::BUFFERED;
     }
 
@@ -146,53 +148,9 @@ StateTracker::ModelItem::State StateTracker::ModelItem::state() const
 
 void StateTracker::ModelItem::remove(bool reparent)
 {
-    // First, update the edges
-    const auto te = isTopEdge();
-    const auto be = isBottomEdge();
-
-    //TODO turn this into a state tracker, really
-    switch(te) {
-        case IndexMetadata::EdgeType::NONE:
-            break;
-        case IndexMetadata::EdgeType::FREE:
-            Q_ASSERT(false); // Impossible, only corrupted memory can cause this
-            break;
-        case IndexMetadata::EdgeType::VISIBLE:
-            if (auto i = q_ptr->find(this, Qt::TopEdge, [](auto i) -> bool {
-              return i->metadata()->modelTracker()->m_State == StateTracker::ModelItem::State::VISIBLE; } )) {
-                Q_ASSERT(i->metadata()->modelTracker()->m_State == StateTracker::ModelItem::State::VISIBLE); //TODO
-                q_ptr->setEdge(IndexMetadata::EdgeType::VISIBLE, i, Qt::TopEdge);
-            }
-            else {
-                Q_ASSERT(false); //TODO clear the edges
-            }
-            break;
-        case IndexMetadata::EdgeType::BUFFERED:
-            Q_ASSERT(false); //TODO as of the time of this comment, it's hald implemented
-            break;
-    }
-
-    switch(be) {
-        case IndexMetadata::EdgeType::NONE:
-            break;
-        case IndexMetadata::EdgeType::FREE:
-            Q_ASSERT(false); // Impossible, only corrupted memory can cause this
-            break;
-        case IndexMetadata::EdgeType::VISIBLE:
-            if (auto i = q_ptr->find(this, Qt::BottomEdge, [](auto i) -> bool {
-              return i->metadata()->modelTracker()->m_State == StateTracker::ModelItem::State::VISIBLE; } )) {
-                Q_ASSERT(i->metadata()->modelTracker()->m_State == StateTracker::ModelItem::State::VISIBLE); //TODO
-                q_ptr->setEdge(IndexMetadata::EdgeType::VISIBLE, i, Qt::BottomEdge);
-            }
-            else {
-                Q_ASSERT(false); //TODO clear the edges
-            }
-            break;
-        case IndexMetadata::EdgeType::BUFFERED:
-            Q_ASSERT(false); //TODO as of the time of this comment, it's hald implemented
-            break;
-    }
-
+    // The edges are updated when the REPARENT transition leaves the current
+    // state (see ContentPrivate::m_fStateLogging). This has to happen while
+    // up() and down() are still valid.
     metadata()->viewport()->s_ptr->notifyRemoval(metadata());
     metadata() << IndexMetadata::LoadAction::REPARENT;
     Index::remove(reparent);
@@ -210,34 +168,40 @@ bool StateTracker::ModelItem::error()
 }
 #pragma GCC diagnostic pop
 
-bool StateTracker::ModelItem::show()
+/**
+ * Create (or recycle) the delegate. It is left in the ViewItem::BUFFER
+ * state, so it exists but is not displayed yet.
+ */
+bool StateTracker::ModelItem::createDelegate()
 {
-    Q_ASSERT(m_State == State::VISIBLE);
+    Q_ASSERT(!metadata()->viewTracker());
 
-    if (metadata()->viewTracker()) {
-        //TODO Implementing this *may* make sense, but for now avoid it.
-        // for now it is undefined behavior, but not fatal
-        Q_ASSERT(false); //TODO not well thought, most definitely broken
-        //item->setVisible(true);
-    }
-    else {
-        Q_ASSERT(metadata()->viewport()->s_ptr->m_fFactory);
-        metadata()->setViewTracker(metadata()->viewport()->s_ptr->m_fFactory()->s_ptr);
-        Q_ASSERT(metadata()->viewTracker());
+    const auto s = metadata()->viewport()->s_ptr;
+    const auto state = m_State;
 
-        metadata() << IndexMetadata::ViewAction::ATTACH;
-        Q_ASSERT(metadata()->viewTracker()->state() == StateTracker::ViewItem::State::POOLED);
-        Q_ASSERT(m_State == State::VISIBLE);
+    // Try to recycle a delegate first
+    auto item = s->takeFromPool(metadata());
 
-        //DEBUG
-        //if (auto item = metadata()->viewTracker()->item())
-        //    qDebug() << "CREATE" << this << item->y() << item->height();
+    if (!item) {
+        Q_ASSERT(s->m_fFactory);
+        item = s->m_fFactory();
     }
 
+    metadata()->setViewTracker(item->s_ptr);
+    Q_ASSERT(metadata()->viewTracker());
+
+    metadata() << IndexMetadata::ViewAction::ATTACH;
+    Q_ASSERT(metadata()->viewTracker()->state() == StateTracker::ViewItem::State::POOLED);
+
+    //DEBUG
+    //if (auto item = metadata()->viewTracker()->item())
+    //    qDebug() << "CREATE" << this << item->y() << item->height();
+
     metadata() << IndexMetadata::ViewAction::ENTER_BUFFER;
 
-    // Make sure no `performAction` loop caused the item to get out of view
-    Q_ASSERT(m_State == State::VISIBLE);
+    // Make sure no `performAction` loop changed the state
+    Q_ASSERT(m_State == state);
+    Q_UNUSED(state)
 
     // When the delegate fails to load (or there is none), there is nothing to do
     if (metadata()->viewTracker()->state() == StateTracker::ViewItem::State::FAILED)
@@ -245,6 +209,25 @@ bool StateTracker::ModelItem::show()
 
     Q_ASSERT(metadata()->viewTracker()->state() == StateTracker::ViewItem::State::BUFFER);
 
+    return true;
+}
+
+bool StateTracker::ModelItem::show()
+{
+    Q_ASSERT(m_State == State::VISIBLE);
+
+    // It was preloaded in the buffer, the geometry is already known. Only the
+    // delegate position has to be applied.
+    if (const auto vi = metadata()->viewTracker()) {
+        if (vi->state() == StateTracker::ViewItem::State::BUFFER)
+            metadata() << IndexMetadata::ViewAction::ENTER_VIEW;
+
+        return true;
+    }
+
+    if (!createDelegate())
+        return false;
+
     metadata() << IndexMetadata::ViewAction::ENTER_VIEW;
 
     // Make sure no `performAction` loop caused the item to get out of view
@@ -341,16 +324,38 @@ bool StateTracker::ModelItem::remove2()
     return true;
 }
 
+/**
+ * Create the delegate, but only display it if it is in the viewport.
+ *
+ * Otherwise it stays hidden in the buffer until the viewport reaches it (see
+ * ViewportSync::updateVisibility).
+ */
 bool StateTracker::ModelItem::attach()
 {
-    Q_ASSERT(m_State != State::VISIBLE && !metadata()->viewTracker());
+    Q_ASSERT(m_State == State::BUFFER && !metadata()->viewTracker());
     _DO_TEST(_test_validate_edges_simple, q_ptr)
 
-    //TODO For now the buffer isn't fully implemented, so items always get
-    // shown when attached.
+    // The items are created in the BUFFER state, so this transition doesn't
+    // change the state and it has to join the buffered edges manually.
+    q_ptr->perfromStateChange(StateTracker::Content::Event::ENTER_STATE, metadata(), m_State);
+
+    const auto s = metadata()->viewport()->s_ptr;
+
+    if (!createDelegate())
+        return false;
+
+    // The visible range has to stay continuous
+    const auto u = up  ();
+    const auto d = down();
+    const bool sandwiched = u && d
+        && u->metadata()->isVisible() && d->metadata()->isVisible();
 
-    //FIXME this ain't correct
-    return metadata() << IndexMetadata::LoadAction::SHOW;
+    if (sandwiched || s->isInViewport(metadata()->decoratedGeometry()))
+        return metadata() << IndexMetadata::LoadAction::SHOW;
+
+    s->updateGeometry(metadata());
+
+    return true;
 }
 
 bool StateTracker::ModelItem::detach()
@@ -367,9 +372,10 @@ bool StateTracker::ModelItem::detach()
     remove2();
     StateTracker::Index::remove();
 
+    // Within a removal transaction, this is deferred until it is committed
     metadata()->viewport()->s_ptr->refreshVisible();
 
-    Q_ASSERT(!loadedChildrenCount() && ((!parent()) || !parent()->childrenLookup(index())));
+    Q_ASSERT(!loadedChildrenCount() && ((!parent()) || !parent()->hasChildren(this)));
     Q_ASSERT(!metadata()->viewTracker());
 
     return true;
@@ -406,7 +412,14 @@ bool StateTracker::ModelItem::move()
             break;
     }
 
-    if (metadata()->viewTracker()) {
+    // The buffered delegates are moved when they enter the viewport
+    const auto vi = metadata()->viewTracker();
+
+    if (vi && vi->state() == StateTracker::ViewItem::State::BUFFER) {
+        if (m_State == State::VISIBLE)
+            metadata() << IndexMetadata::ViewAction::ENTER_VIEW;
+    }
+    else if (vi) {
         metadata() << IndexMetadata::ViewAction::MOVE;
         //Q_ASSERT(metadata()->isInSync());//TODO THIS_COMMIT
     }
@@ -425,7 +438,8 @@ bool StateTracker::ModelItem::destroy()
 
     Q_ASSERT((!metadata()->viewTracker()) && !loadedChildrenCount());
 
-    delete this;
+    // It was allocated by the Content slab
+    metadata()->viewport()->s_ptr->m_pReflector->destroyItem(this);
     return true;
 }
 
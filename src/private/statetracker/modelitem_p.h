@@ -78,6 +78,9 @@ private:
     bool destroy();
     bool reset  ();
 
+    // Helpers
+    bool createDelegate();
+
     // Attributes
     State m_State {State::BUFFER};
 
@@ -75,6 +75,11 @@ StateTracker::Proximity::Proximity(IndexMetadata *q, StateTracker::Index *self)
     d_ptr->m_pSelf = self;
 }
 
+StateTracker::Proximity::~Proximity()
+{
+    delete d_ptr;
+}
+
 void StateTracker::Proximity::performAction(IndexMetadata::ProximityAction a, Qt::Edge e)
 {
     Q_UNUSED(e)
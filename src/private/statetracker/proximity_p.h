@@ -44,6 +44,7 @@ class Proximity
 {
 public:
     explicit Proximity(IndexMetadata *q, StateTracker::Index *self);
+    ~Proximity();
 
     enum class State {
         UNKNOWN , /*!< The information is not availablr           */
@@ -0,0 +1,461 @@
+/***************************************************************************
+ *   Copyright (C) 2019 by Emmanuel Lepage Vallee                          *
+ *   Author : Emmanuel Lepage Vallee <emmanuel.lepage@kde.org>             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+#include "siblingtree_p.h"
+
+// Qt
+#include <QtCore/QVarLengthArray>
+
+// KQuickItemViews
+#include "index_p.h"
+
+StateTracker::SiblingTree::Node &StateTracker::SiblingTree::node(const Index *i)
+{
+    return const_cast<Index*>(i)->m_Node;
+}
+
+uint StateTracker::SiblingTree::sizeOf(const Index *i)
+{
+    return i ? node(i).m_Size : 0;
+}
+
+int StateTracker::SiblingTree::rowOf(const Index *i)
+{
+    // Do not use effectiveRow(), the tree order is only updated when the
+    // elements are re-inserted at their new position.
+    return i->modelRow();
+}
+
+uint StateTracker::SiblingTree::randomPriority()
+{
+    // xorshift32, it only has to prevent the sorted insertions from
+    // degenerating into a linked list. This is only used from the GUI thread.
+    static quint32 s = 2463534242u;
+
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+
+    return s;
+}
+
+void StateTracker::SiblingTree::update(Index *i)
+{
+    auto &n = node(i);
+    n.m_Size = 1 + sizeOf(n.m_pLeft) + sizeOf(n.m_pRight);
+}
+
+StateTracker::Index *StateTracker::SiblingTree::leftmost(Index *i)
+{
+    while (i && node(i).m_pLeft)
+        i = node(i).m_pLeft;
+
+    return i;
+}
+
+StateTracker::Index *StateTracker::SiblingTree::rightmost(Index *i)
+{
+    while (i && node(i).m_pRight)
+        i = node(i).m_pRight;
+
+    return i;
+}
+
+int StateTracker::SiblingTree::size() const
+{
+    return sizeOf(m_pRoot);
+}
+
+bool StateTracker::SiblingTree::isEmpty() const
+{
+    return !m_pRoot;
+}
+
+bool StateTracker::SiblingTree::contains(const Index *i) const
+{
+    if (!i || !node(i).m_Size)
+        return false;
+
+    while (node(i).m_pUp)
+        i = node(i).m_pUp;
+
+    return i == m_pRoot;
+}
+
+StateTracker::Index *StateTracker::SiblingTree::first() const
+{
+    return leftmost(m_pRoot);
+}
+
+StateTracker::Index *StateTracker::SiblingTree::last() const
+{
+    return rightmost(m_pRoot);
+}
+
+/// In-order successor, this should match Index::nextSibling()
+StateTracker::Index *StateTracker::SiblingTree::next(const Index *i)
+{
+    if (auto r = node(i).m_pRight)
+        return leftmost(r);
+
+    auto up = node(i).m_pUp;
+
+    while (up && node(up).m_pRight == i) {
+        i  = up;
+        up = node(up).m_pUp;
+    }
+
+    return up;
+}
+
+StateTracker::Index *StateTracker::SiblingTree::find(int row) const
+{
+    auto i = m_pRoot;
+
+    while (i) {
+        const int r = rowOf(i);
+
+        if (r == row)
+            return i;
+
+        i = row < r ? node(i).m_pLeft : node(i).m_pRight;
+    }
+
+    return nullptr;
+}
+
+/// Return the first loaded element with a row equal or greater than `row`
+StateTracker::Index *StateTracker::SiblingTree::lowerBound(int row) const
+{
+    Index *ret = nullptr;
+    auto i = m_pRoot;
+
+    while (i) {
+        if (rowOf(i) >= row) {
+            ret = i;
+            i   = node(i).m_pLeft;
+        }
+        else
+            i = node(i).m_pRight;
+    }
+
+    return ret;
+}
+
+StateTracker::Index *StateTracker::SiblingTree::at(int position) const
+{
+    auto i = m_pRoot;
+
+    while (i) {
+        const int s = sizeOf(node(i).m_pLeft);
+
+        if (position == s)
+            return i;
+
+        if (position < s)
+            i = node(i).m_pLeft;
+        else {
+            position -= s + 1;
+            i = node(i).m_pRight;
+        }
+    }
+
+    return nullptr;
+}
+
+int StateTracker::SiblingTree::position(const Index *i) const
+{
+    Q_ASSERT(contains(i));
+
+    int ret = sizeOf(node(i).m_pLeft);
+
+    while (auto up = node(i).m_pUp) {
+        if (node(up).m_pRight == i)
+            ret += sizeOf(node(up).m_pLeft) + 1;
+
+        i = up;
+    }
+
+    return ret;
+}
+
+void StateTracker::SiblingTree::replaceChild(Index *up, Index *old, Index *i)
+{
+    if (!up)
+        m_pRoot = i;
+    else if (node(up).m_pLeft == old)
+        node(up).m_pLeft = i;
+    else {
+        Q_ASSERT(node(up).m_pRight == old);
+        node(up).m_pRight = i;
+    }
+
+    if (i)
+        node(i).m_pUp = up;
+}
+
+/// Rotate `i` above its parent, this preserves the in-order traversal
+void StateTracker::SiblingTree::rotateUp(Index *i)
+{
+    auto &n = node(i);
+    auto  p = n.m_pUp;
+    auto  g = node(p).m_pUp;
+
+    Q_ASSERT(p);
+
+    if (node(p).m_pLeft == i) {
+        node(p).m_pLeft = n.m_pRight;
+
+        if (n.m_pRight)
+            node(n.m_pRight).m_pUp = p;
+
+        n.m_pRight = p;
+    }
+    else {
+        node(p).m_pRight = n.m_pLeft;
+
+        if (n.m_pLeft)
+            node(n.m_pLeft).m_pUp = p;
+
+        n.m_pLeft = p;
+    }
+
+    replaceChild(g, p, i);
+    node(p).m_pUp = i;
+
+    update(p);
+    update(i);
+}
+
+void StateTracker::SiblingTree::attach(Index *i, Index *up, bool left)
+{
+    (left ? node(up).m_pLeft : node(up).m_pRight) = i;
+    node(i).m_pUp = up;
+
+    for (auto p = up; p; p = node(p).m_pUp)
+        node(p).m_Size++;
+
+    // Restore the heap property
+    while (node(i).m_pUp && node(node(i).m_pUp).m_Priority < node(i).m_Priority)
+        rotateUp(i);
+}
+
+/// Insert `i` before `other`, or at the end if `other` is `nullptr`
+void StateTracker::SiblingTree::insertBefore(Index *i, Index *other)
+{
+    Q_ASSERT(!node(i).m_Size);
+    Q_ASSERT((!other) || contains(other));
+
+    node(i) = {nullptr, nullptr, nullptr, 1, randomPriority()};
+
+    if (!m_pRoot) {
+        m_pRoot = i;
+        return;
+    }
+
+    if (!other)
+        attach(i, last(), false);
+    else if (!node(other).m_pLeft)
+        attach(i, other, true);
+    else
+        attach(i, rightmost(node(other).m_pLeft), false);
+}
+
+/// Insert `i` after `other`, or at the beginning if `other` is `nullptr`
+void StateTracker::SiblingTree::insertAfter(Index *i, Index *other)
+{
+    Q_ASSERT(!node(i).m_Size);
+    Q_ASSERT((!other) || contains(other));
+
+    node(i) = {nullptr, nullptr, nullptr, 1, randomPriority()};
+
+    if (!m_pRoot) {
+        m_pRoot = i;
+        return;
+    }
+
+    if (!other)
+        attach(i, first(), true);
+    else if (!node(other).m_pRight)
+        attach(i, other, false);
+    else
+        attach(i, leftmost(node(other).m_pRight), true);
+}
+
+StateTracker::Index *StateTracker::SiblingTree::merge(Index *a, Index *b)
+{
+    if (!a)
+        return b;
+
+    if (!b)
+        return a;
+
+    if (node(a).m_Priority > node(b).m_Priority) {
+        auto m = merge(node(a).m_pRight, b);
+        node(a).m_pRight = m;
+        node(m).m_pUp = a;
+        update(a);
+        return a;
+    }
+
+    auto m = merge(a, node(b).m_pLeft);
+    node(b).m_pLeft = m;
+    node(m).m_pUp = b;
+    update(b);
+
+    return b;
+}
+
+/// Split `t` into the first `count` elements and the rest
+void StateTracker::SiblingTree::split(Index *t, int count, Index **l, Index **r)
+{
+    if (!t) {
+        *l = *r = nullptr;
+        return;
+    }
+
+    auto &n = node(t);
+    const int leftSize = sizeOf(n.m_pLeft);
+
+    Index *a(nullptr), *b(nullptr);
+
+    if (leftSize < count) {
+        split(n.m_pRight, count - leftSize - 1, &a, &b);
+        n.m_pRight = a;
+
+        if (a)
+            node(a).m_pUp = t;
+
+        *l = t;
+        *r = b;
+    }
+    else {
+        split(n.m_pLeft, count, &a, &b);
+        n.m_pLeft = b;
+
+        if (b)
+            node(b).m_pUp = t;
+
+        *l = a;
+        *r = t;
+    }
+
+    update(t);
+}
+
+/**
+ * Insert the elements from `first` to `last` (linked using
+ * Index::nextSibling()) before `other` (or at the end).
+ *
+ * Inserting K elements is O(K + log N) instead of O(K * log N). The subtree is
+ * built in a single pass (a cartesian tree) then spliced.
+ */
+void StateTracker::SiblingTree::insertChainBefore(Index *first, Index *last, Index *other)
+{
+    Q_ASSERT(first && last);
+    Q_ASSERT((!other) || contains(other));
+
+    QVarLengthArray<Index*, 64> stack;
+
+    for (auto i = first; i; i = (i == last) ? nullptr : i->nextSibling()) {
+        Q_ASSERT(!node(i).m_Size);
+        node(i) = {nullptr, nullptr, nullptr, 1, randomPriority()};
+
+        // Everything popped has a complete subtree, so its size is final
+        Index *popped = nullptr;
+
+        while ((!stack.isEmpty()) && node(stack.last()).m_Priority < node(i).m_Priority) {
+            popped = stack.last();
+            stack.removeLast();
+            update(popped);
+        }
+
+        node(i).m_pLeft = popped;
+
+        if (popped)
+            node(popped).m_pUp = i;
+
+        if (!stack.isEmpty()) {
+            node(stack.last()).m_pRight = i;
+            node(i).m_pUp = stack.last();
+        }
+
+        stack.append(i);
+    }
+
+    Q_ASSERT(!stack.isEmpty());
+
+    for (int j = stack.size() - 1; j >= 0; j--)
+        update(stack[j]);
+
+    auto chain = stack.first();
+
+    Index *l(nullptr), *r(nullptr);
+    split(m_pRoot, other ? position(other) : size(), &l, &r);
+
+    m_pRoot = merge(merge(l, chain), r);
+    node(m_pRoot).m_pUp = nullptr;
+}
+
+void StateTracker::SiblingTree::remove(Index *i)
+{
+    Q_ASSERT(contains(i));
+
+    // Rotate it down until it has at most one child
+    while (node(i).m_pLeft && node(i).m_pRight) {
+        auto l = node(i).m_pLeft;
+        auto r = node(i).m_pRight;
+        rotateUp(node(l).m_Priority > node(r).m_Priority ? l : r);
+    }
+
+    const auto up    = node(i).m_pUp;
+    const auto child = node(i).m_pLeft ? node(i).m_pLeft : node(i).m_pRight;
+
+    replaceChild(up, i, child);
+
+    for (auto p = up; p; p = node(p).m_pUp)
+        node(p).m_Size--;
+
+    node(i) = {};
+}
+
+/// O(N), it has to reset the nodes
+void StateTracker::SiblingTree::clear()
+{
+    auto i = m_pRoot;
+
+    // Post-order, without a stack
+    while (i) {
+        auto &n = node(i);
+
+        if (n.m_pLeft)
+            i = n.m_pLeft;
+        else if (n.m_pRight)
+            i = n.m_pRight;
+        else {
+            const auto up = n.m_pUp;
+
+            if (up)
+                (node(up).m_pLeft == i ? node(up).m_pLeft : node(up).m_pRight) = nullptr;
+
+            n = {};
+            i = up;
+        }
+    }
+
+    m_pRoot = nullptr;
+}
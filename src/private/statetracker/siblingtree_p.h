@@ -0,0 +1,104 @@
+/***************************************************************************
+ *   Copyright (C) 2019 by Emmanuel Lepage Vallee                          *
+ *   Author : Emmanuel Lepage Vallee <emmanuel.lepage@kde.org>             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+#ifndef KQUICKITEMVIEWS_SIBLINGTREE_P_H
+#define KQUICKITEMVIEWS_SIBLINGTREE_P_H
+
+#include <QtCore/QtGlobal>
+
+namespace StateTracker {
+
+class Index;
+
+/**
+ * Ordered lookup of the loaded children of a StateTracker::Index.
+ *
+ * It used to be a QHash<QPersistentModelIndex, Index*>. This had 2 problems.
+ * Hashing a QPersistentModelIndex isn't free and is done for every row of
+ * every range the model reports. It also has no notion of order, so range
+ * queries ("the loaded children between row 100 and 200") had to probe every
+ * row of the range or walk the sibling list from the first child.
+ *
+ * This is an intrusive randomized binary search tree (a treap). The nodes
+ * are embedded in the StateTracker::Index, so it never allocates. Its
+ * in-order traversal always matches the sibling linked list. Because the
+ * siblings are sorted by row (outside of the rowsAboutToBeMoved/rowsMoved
+ * transition), it can be searched by row without storing the row anywhere.
+ * The QPersistentModelIndex already keeps the rows up to date, so there is
+ * no key to shift when the model inserts or removes rows (the elements
+ * without one are shifted by the Content, see Index::dropPersistentIndex).
+ *
+ * Each node also tracks its subtree size. This makes it an order statistic
+ * tree and allows ranges to be spliced in O(log N).
+ *
+ * All operations are O(log N) (expected) unless noted otherwise.
+ */
+class SiblingTree final
+{
+public:
+    /// The part of the tree embedded in each StateTracker::Index
+    struct Node {
+        Index *m_pLeft    {nullptr};
+        Index *m_pRight   {nullptr};
+        Index *m_pUp      {nullptr};
+        uint   m_Size     {   0   }; /*!< 0 when not in a tree */
+        uint   m_Priority {   0   };
+    };
+
+    // Getter
+    int size() const;
+    bool isEmpty() const;
+    bool contains(const Index *i) const;
+
+    Index *first() const;
+    Index *last () const;
+    static Index *next(const Index *i);
+
+    // Lookup
+    Index *find(int row) const;
+    Index *lowerBound(int row) const;
+    Index *at(int position) const;
+    int position(const Index *i) const;
+
+    // Mutator
+    void insertBefore(Index *i, Index *other);
+    void insertAfter (Index *i, Index *other);
+    void insertChainBefore(Index *first, Index *last, Index *other);
+    void remove(Index *i);
+    void clear();
+
+private:
+    Index *m_pRoot {nullptr};
+
+    // Helpers
+    static Node &node(const Index *i);
+    static uint sizeOf(const Index *i);
+    static int rowOf(const Index *i);
+    static uint randomPriority();
+    static void update(Index *i);
+    static Index *leftmost(Index *i);
+    static Index *rightmost(Index *i);
+    static Index *merge(Index *a, Index *b);
+    static void split(Index *t, int count, Index **l, Index **r);
+    void replaceChild(Index *up, Index *old, Index *i);
+    void rotateUp(Index *i);
+    void attach(Index *i, Index *up, bool left);
+};
+
+}
+
+#endif
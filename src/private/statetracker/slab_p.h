@@ -0,0 +1,143 @@
+/***************************************************************************
+ *   Copyright (C) 2019 by Emmanuel Lepage Vallee                          *
+ *   Author : Emmanuel Lepage Vallee <emmanuel.lepage@kde.org>             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+#ifndef KQUICKITEMVIEWS_SLAB_P_H
+#define KQUICKITEMVIEWS_SLAB_P_H
+
+// Qt
+#include <QtCore/QVector>
+
+// LibStdC++
+#include <new>
+#include <utility>
+
+namespace StateTracker {
+
+/**
+ * Allocate objects of the same type in large contiguous chunks.
+ *
+ * Each loaded row used to be its own heap allocation. They ended up scattered
+ * across the heap and walking the loaded elements (in refreshVisible or
+ * when updating the edges) was hostile to the CPU cache.
+ *
+ * The freed slots are recycled (last freed, first reused). The chunks are
+ * only returned to the system when the slab becomes empty and release() is
+ * called, which is what happens when the whole tree is discarded.
+ *
+ * This is not thread safe, like the rest of the state trackers it is only
+ * used from the GUI thread.
+ */
+template<typename T, int ChunkSize = 256>
+class Slab final
+{
+public:
+    Slab() = default;
+    Slab(const Slab&) = delete;
+    Slab& operator=(const Slab&) = delete;
+    ~Slab();
+
+    // Mutator
+    template<typename ...Args>
+    T *create(Args&&... args);
+    void destroy(T *t);
+    bool release();
+
+    // Getter
+    int size() const { return m_Size; }
+    int capacity() const { return m_lChunks.size() * ChunkSize; }
+    int allocationCount() const { return m_AllocationCount; }
+
+private:
+    union Slot {
+        Slot *m_pNext;
+        alignas(T) char m_Storage[sizeof(T)];
+    };
+
+    QVector<Slot*> m_lChunks;
+    Slot *m_pFree {nullptr};
+    int m_Size {0};
+    int m_AllocationCount {0};
+};
+
+template<typename T, int ChunkSize>
+Slab<T, ChunkSize>::~Slab()
+{
+    // There can still be elements if the tree leaked some of them. Their
+    // destructor is not called, but it would not have been called either.
+    for (auto c : qAsConst(m_lChunks))
+        delete[] c;
+}
+
+template<typename T, int ChunkSize>
+template<typename ...Args>
+T *Slab<T, ChunkSize>::create(Args&&... args)
+{
+    if (!m_pFree) {
+        auto c = new Slot[ChunkSize];
+        m_lChunks << c;
+        m_AllocationCount++;
+
+        // Link them in order so consecutive elements are next to each other
+        for (int i = 0; i < ChunkSize - 1; i++)
+            c[i].m_pNext = &c[i+1];
+
+        c[ChunkSize - 1].m_pNext = nullptr;
+        m_pFree = c;
+    }
+
+    auto s  = m_pFree;
+    m_pFree = s->m_pNext;
+    m_Size++;
+
+    return new (s->m_Storage) T(std::forward<Args>(args)...);
+}
+
+template<typename T, int ChunkSize>
+void Slab<T, ChunkSize>::destroy(T *t)
+{
+    if (!t)
+        return;
+
+    Q_ASSERT(m_Size > 0);
+
+    t->~T();
+
+    auto s = reinterpret_cast<Slot*>(t);
+    s->m_pNext = m_pFree;
+    m_pFree = s;
+    m_Size--;
+}
+
+/// Free all chunks at once, this is only possible when the slab is empty
+template<typename T, int ChunkSize>
+bool Slab<T, ChunkSize>::release()
+{
+    if (m_Size)
+        return false;
+
+    for (auto c : qAsConst(m_lChunks))
+        delete[] c;
+
+    m_lChunks.clear();
+    m_pFree = nullptr;
+
+    return true;
+}
+
+}
+
+#endif
@@ -27,6 +27,7 @@ class Viewport;
 class IndexMetadata;
 class AbstractItemAdapter;
 class GeoStrategySelector;
+class ContextAdapter;
 class ViewBaseItemVariables;
 
 namespace StateTracker {
@@ -35,8 +36,12 @@ class Content;
 
 #include <QtCore/QRectF>
 #include <QtCore/QModelIndex>
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+#include <QtCore/QPair>
 
 #include "statetracker/geometry_p.h"
+#include "rowextents_p.h"
 
 /**
  * In order to keep the separation of concerns design goal intact, this
@@ -72,14 +77,81 @@ public:
      */
     void notifyChange(IndexMetadata* item);
 
+    /**
+     * From the GeometryAdapter when the size of unloaded rows is known
+     */
+    void notifyExtentsChanged();
+
     /**
      * Manually trigger the sizes and positions to be updated.
      */
     void refreshVisible();
 
+    /**
+     * Batch the refreshVisible() calls caused by a model mutation.
+     *
+     * Within a transaction, refreshVisible() only marks the viewport as dirty.
+     * The outermost commitTransaction() then refreshes it once.
+     */
+    void beginTransaction();
+    void commitTransaction();
+
+    /**
+     * The loaded elements outside of the viewport are kept in the BUFFER
+     * state. Their delegates exist, but are hidden and their position is only
+     * applied once they enter the viewport.
+     *
+     * The buffer spans ModelAdapter::cacheBuffer elements or
+     * ModelAdapter::cacheBufferHeight pixels (whichever is larger) on each
+     * side of the viewport.
+     */
+    bool isInViewport(const QRectF &geometry) const;
+    QRectF bufferRect() const;
+    void updateVisibility();
+
     QQmlEngine    *engine();
     QQmlComponent *component();
 
+    /**
+     * The delegate recycling pool (see ModelAdapter::recyclingMode).
+     *
+     * The detached delegates are kept (hidden) along with their context and
+     * rebound to the next index which needs one. There is one pool per depth
+     * when the delegates differ per level and each of them holds at most
+     * ModelAdapter::poolSize delegates.
+     */
+    AbstractItemAdapter *takeFromPool(IndexMetadata *md);
+    bool addToPool(IndexMetadata *md, AbstractItemAdapter *item);
+    void clearPool();
+
+    int m_PoolHits   {0};
+    int m_PoolMisses {0};
+
+    /**
+     * The extents of the top level rows, including the unloaded ones.
+     *
+     * They are used to guess where the rows which are not loaded are. Their
+     * positions are relative to the closest loaded element.
+     */
+    qreal rowPosition(int row) const;
+    int rowAt(qreal y) const;
+
+    /**
+     * The estimated top and bottom of the whole content.
+     *
+     * The loaded elements (including the children of the expanded rows) are
+     * exact, the rest is extrapolated from the extents. It converges as more
+     * rows are measured.
+     */
+    QPair<qreal, qreal> contentEdges() const;
+
+    /// The height of every row when it is known to be uniform, otherwise 0
+    qreal uniformHeight() const;
+
+    bool isBottomAnchored() const;
+
+    RowExtents m_Extents;
+
     IndexMetadata *metadataForIndex(const QModelIndex& idx) const;
 
     Viewport *q_ptr;
@@ -90,6 +162,16 @@ public:
 private:
     QQmlEngine    *m_pEngine    {nullptr};
     QQmlComponent *m_pComponent {nullptr};
+
+    int  m_TransactionDepth {  0  };
+    bool m_IsDirty          {false};
+    bool m_IsUpdatingVisibility {false};
+
+    QHash<int, QVector<QPair<AbstractItemAdapter*, ContextAdapter*>>> m_hPool;
+
+    int poolKey(IndexMetadata *md) const;
+    bool reflowUp(IndexMetadata *item);
+    QPair<int, qreal> extentAnchor(bool above) const;
 };
 
 #endif
@@ -24,6 +24,7 @@
 #include <KQuickItemViews/adapters/selectionadapter.h>
 #include <KQuickItemViews/adapters/contextadapter.h>
 #include <KQuickItemViews/adapters/modeladapter.h>
+#include <KQuickItemViews/adapters/loadingadapter.h>
 #include "viewport.h"
 #include "private/viewport_p.h"
 #include "private/geostrategyselector_p.h"
@@ -166,8 +167,8 @@ bool SingleModelViewBase::hasUniformRowHeight() const
 
 void SingleModelViewBase::setUniformRowHeight(bool value)
 {
-    Q_UNUSED(value)
-    //d_ptr->m_pModelAdapter->setUniformRowHeight(value);
+    d_ptr->m_pModelAdapter->viewports().constFirst()->s_ptr->
+        m_pGeoAdapter->setHasUniformSize(value);
 }
 
 bool SingleModelViewBase::hasUniformColumnWidth() const
@@ -182,13 +183,23 @@ void SingleModelViewBase::setUniformColumnColumnWidth(bool value)
     //d_ptr->m_pModelAdapter->setUniformColumnColumnWidth(value);
 }
 
+bool SingleModelViewBase::isAsynchronous() const
+{
+    return d_ptr->m_pModelAdapter->loadingAdapter()->isAsynchronous();
+}
+
+void SingleModelViewBase::setAsynchronous(bool value)
+{
+    d_ptr->m_pModelAdapter->loadingAdapter()->setAsynchronous(value);
+}
+
 void SingleModelViewBase::moveTo(Qt::Edge e)
 {
     QTimer::singleShot(0, [this, e]() {
         //HACK This need the viewportAdapter to be optimized
         switch(e) {
             case Qt::TopEdge:
-                setContentY(0);
+                setContentY(originY());
                 break;
             case Qt::BottomEdge: {
                 int y = contentY();
@@ -61,6 +61,9 @@ public:
     /// Assume each column has the same width (for performance)
     Q_PROPERTY(bool uniformColumnWidth READ hasUniformColumnWidth WRITE setUniformColumnColumnWidth)
 
+    /// Incubate the delegates asynchronously (see LoadingAdapter)
+    Q_PROPERTY(bool asynchronous READ isAsynchronous WRITE setAsynchronous)
+
     /**
      * It is usually recommanded to use the template constructor unless there is
      * extra logic to be executed when an item is created.
@@ -102,6 +105,9 @@ public:
     bool hasUniformColumnWidth() const;
     void setUniformColumnColumnWidth(bool value);
 
+    bool isAsynchronous() const;
+    void setAsynchronous(bool value);
+
     QModelIndex topLeft    () const;
     QModelIndex topRight   () const;
     QModelIndex bottomLeft () const;
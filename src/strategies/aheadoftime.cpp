@@ -17,21 +17,297 @@
  **************************************************************************/
 #include "aheadoftime.h"
 
-#include <adapters/abstractitemadapter.h>
-#include <private/statetracker/viewitem_p.h>
+// Qt
+#include <QtCore/QAbstractItemModel>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QTimer>
+#include <QtCore/QVector>
 
-GeometryStrategies::AheadOfTime::AheadOfTime(Viewport *parent) : GeometryAdapter(parent)
+// LibStdC++
+#include <algorithm>
+
+// KQuickItemViews
+#include <viewport.h>
+#include <viewbase.h>
+#include <adapters/modeladapter.h>
+#include <private/viewport_p.h>
+#include <private/delegatemeasurer_p.h>
+
+class AheadOfTimeStrategiesPrivate : public QObject
 {
-    setCapabilities(Capabilities::TRACKS_QQUICKITEM_GEOMETRY);
+    Q_OBJECT
+public:
+    explicit AheadOfTimeStrategiesPrivate(GeometryStrategies::AheadOfTime *q);
+
+    /// The height of each top level row, -1 until it is measured
+    QVector<float> m_lHeights;
+
+    int                 m_Cursor   {   0   }; /*!< Everything above is measured */
+    int                 m_Measured {   0   };
+    int                 m_Budget   {   4   };
+    QAbstractItemModel *m_pModel   {nullptr};
+    QTimer              m_Timer    {       };
+    DelegateMeasurer    m_Measurer;
+
+    QVector<QMetaObject::Connection> m_lConnections;
+
+    void setModel(QAbstractItemModel *m);
+    void setHeight(int row, qreal height);
+    void invalidate(int first, int last);
+    void schedule(int from);
+
+    GeometryStrategies::AheadOfTime *q_ptr;
+
+public Q_SLOTS:
+    void slotMeasure();
+    void slotReset();
+    void slotRowsInserted(const QModelIndex &parent, int first, int last);
+    void slotRowsRemoved(const QModelIndex &parent, int first, int last);
+    void slotRowsMoved(const QModelIndex &p, int start, int end, const QModelIndex &dest, int row);
+    void slotDataChanged(const QModelIndex &tl, const QModelIndex &br);
+};
+
+AheadOfTimeStrategiesPrivate::AheadOfTimeStrategiesPrivate(GeometryStrategies::AheadOfTime *q) :
+    QObject(q), m_Measurer(q->viewport()), q_ptr(q)
+{}
+
+GeometryStrategies::AheadOfTime::AheadOfTime(Viewport *parent) : GeometryAdapter(parent),
+    d_ptr(new AheadOfTimeStrategiesPrivate(this))
+{
+    setCapabilities(
+        Capabilities::HAS_AHEAD_OF_TIME |
+        Capabilities::ALWAYS_HAS_SIZE_HINTS
+    );
+
+    d_ptr->m_Timer.setSingleShot(true);
+    d_ptr->m_Timer.setInterval(0);
+
+    QObject::connect(&d_ptr->m_Timer, &QTimer::timeout,
+        d_ptr, &AheadOfTimeStrategiesPrivate::slotMeasure);
+
+    if (!parent)
+        return;
+
+    QObject::connect(parent->modelAdapter(), &ModelAdapter::modelChanged,
+        d_ptr, &AheadOfTimeStrategiesPrivate::setModel);
+
+    QObject::connect(parent->modelAdapter(), &ModelAdapter::delegateChanged,
+        d_ptr, &AheadOfTimeStrategiesPrivate::slotReset);
+
+    d_ptr->setModel(parent->modelAdapter()->rawModel());
 }
 
 GeometryStrategies::AheadOfTime::~AheadOfTime()
-{}
+{
+    // d_ptr is a QObject child
+}
 
 QSizeF GeometryStrategies::AheadOfTime::sizeHint(const QModelIndex &index, AbstractItemAdapter *adapter) const
 {
-    Q_UNUSED(index)
-    Q_ASSERT(adapter);
-    Q_ASSERT(false);
-    return {};
+    // The size of the delegate instance isn't used, it may still be
+    // incubating and the other rows are measured using the same instance.
+    Q_UNUSED(adapter)
+
+    if ((!viewport()) || !index.isValid())
+        return {};
+
+    const int row = index.row();
+
+    if (index.parent().isValid() || row >= d_ptr->m_lHeights.size())
+        return d_ptr->m_Measurer.measure(index);
+
+    if (d_ptr->m_lHeights[row] >= 0)
+        return QSizeF(viewport()->modelAdapter()->view()->width(), d_ptr->m_lHeights[row]);
+
+    // It is needed now, don't wait for its turn
+    const auto ret = d_ptr->m_Measurer.measure(index);
+
+    if (ret.isValid())
+        d_ptr->setHeight(row, ret.height());
+
+    return ret;
+}
+
+qreal GeometryStrategies::AheadOfTime::progress() const
+{
+    return d_ptr->m_lHeights.isEmpty() ?
+        1.0 : d_ptr->m_Measured / (qreal) d_ptr->m_lHeights.size();
+}
+
+bool GeometryStrategies::AheadOfTime::isComplete() const
+{
+    return d_ptr->m_Measured == d_ptr->m_lHeights.size();
+}
+
+int GeometryStrategies::AheadOfTime::budget() const
+{
+    return d_ptr->m_Budget;
+}
+
+void GeometryStrategies::AheadOfTime::setBudget(int ms)
+{
+    d_ptr->m_Budget = std::max(1, ms);
+}
+
+void AheadOfTimeStrategiesPrivate::setModel(QAbstractItemModel *m)
+{
+    for (const auto &c : qAsConst(m_lConnections))
+        QObject::disconnect(c);
+
+    m_lConnections.clear();
+
+    m_pModel = m;
+
+    if (m) {
+        m_lConnections
+            << connect(m, &QAbstractItemModel::rowsInserted,
+                this, &AheadOfTimeStrategiesPrivate::slotRowsInserted)
+            << connect(m, &QAbstractItemModel::rowsRemoved,
+                this, &AheadOfTimeStrategiesPrivate::slotRowsRemoved)
+            << connect(m, &QAbstractItemModel::rowsMoved,
+                this, &AheadOfTimeStrategiesPrivate::slotRowsMoved)
+            << connect(m, &QAbstractItemModel::dataChanged,
+                this, &AheadOfTimeStrategiesPrivate::slotDataChanged)
+            << connect(m, &QAbstractItemModel::modelReset,
+                this, &AheadOfTimeStrategiesPrivate::slotReset)
+            << connect(m, &QAbstractItemModel::layoutChanged,
+                this, &AheadOfTimeStrategiesPrivate::slotReset);
+    }
+
+    slotReset();
+}
+
+void AheadOfTimeStrategiesPrivate::setHeight(int row, qreal height)
+{
+    if (m_lHeights[row] < 0)
+        m_Measured++;
+
+    m_lHeights[row] = height;
+
+    // Make the positions of the unloaded rows exact (see Viewport::rowPosition)
+    auto &extents = q_ptr->viewport()->s_ptr->m_Extents;
+
+    if (row < extents.rowCount())
+        extents.setExtent(row, height);
+}
+
+void AheadOfTimeStrategiesPrivate::invalidate(int first, int last)
+{
+    for (int i = first; i <= last; i++) {
+        if (m_lHeights[i] >= 0)
+            m_Measured--;
+
+        m_lHeights[i] = -1;
+    }
+
+    schedule(first);
+}
+
+void AheadOfTimeStrategiesPrivate::schedule(int from)
+{
+    m_Cursor = std::min(m_Cursor, from);
+
+    emit q_ptr->progressChanged();
+
+    if (m_Cursor < m_lHeights.size() && !m_Timer.isActive())
+        m_Timer.start();
+}
+
+/**
+ * Measure the rows until the budget is spent, then yield to the event loop
+ * so the frames can still be rendered.
+ */
+void AheadOfTimeStrategiesPrivate::slotMeasure()
+{
+    if (!(m_pModel && q_ptr->viewport()))
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const int count = m_lHeights.size();
+
+    while (m_Cursor < count && timer.elapsed() < m_Budget) {
+        if (m_lHeights[m_Cursor] < 0) {
+            const auto s = m_Measurer.measure(m_pModel->index(m_Cursor, 0));
+
+            // Skip it, it will be measured when it is loaded or when the
+            // delegate changes
+            if (s.isValid())
+                setHeight(m_Cursor, s.height());
+        }
+
+        m_Cursor++;
+    }
+
+    emit q_ptr->progressChanged();
+
+    q_ptr->viewport()->s_ptr->notifyExtentsChanged();
+
+    if (m_Cursor < count)
+        m_Timer.start();
+}
+
+void AheadOfTimeStrategiesPrivate::slotReset()
+{
+    m_Measurer.reset();
+
+    m_lHeights.fill(-1, m_pModel ? m_pModel->rowCount() : 0);
+    m_Measured = 0;
+    m_Cursor   = 0;
+
+    schedule(0);
 }
+
+void AheadOfTimeStrategiesPrivate::slotRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid())
+        return;
+
+    m_lHeights.insert(first, last - first + 1, -1);
+
+    schedule(first);
+}
+
+void AheadOfTimeStrategiesPrivate::slotRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid())
+        return;
+
+    for (int i = first; i <= last; i++)
+        m_Measured -= m_lHeights[i] >= 0 ? 1 : 0;
+
+    m_lHeights.remove(first, last - first + 1);
+
+    // Nothing has to be measured, but the cursor has to stay in range
+    schedule(first);
+}
+
+void AheadOfTimeStrategiesPrivate::slotRowsMoved(const QModelIndex &p, int start, int end, const QModelIndex &dest, int row)
+{
+    // Moving from or to a child is the same as a removal or insertion
+    if (p.isValid() && dest.isValid())
+        return;
+    else if (dest.isValid())
+        return slotRowsRemoved(p, start, end);
+    else if (p.isValid())
+        return slotRowsInserted(dest, row, row + end - start);
+
+    // The measured heights are still valid
+    const auto b = m_lHeights.begin();
+
+    if (row < start)
+        std::rotate(b + row, b + start, b + end + 1);
+    else if (row > end + 1)
+        std::rotate(b + start, b + end + 1, b + row);
+}
+
+void AheadOfTimeStrategiesPrivate::slotDataChanged(const QModelIndex &tl, const QModelIndex &br)
+{
+    if (tl.parent().isValid())
+        return;
+
+    invalidate(tl.row(), br.row());
+}
+
+#include <aheadoftime.moc>
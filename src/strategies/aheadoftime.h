@@ -20,21 +20,52 @@
 
 #include <adapters/geometryadapter.h>
 class Viewport;
+class AheadOfTimeStrategiesPrivate;
 
 namespace GeometryStrategies
 {
 
 /**
+ * Measure all the rows ahead of time.
  *
+ * This allows exact scrollbars and positions for any row, even when they
+ * have different heights. The rows are measured using a single hidden
+ * delegate instance (see DelegateMeasurer), a few at a time, when the event
+ * loop is idle. The rows which are not measured yet use the average height
+ * until they are.
+ *
+ * Only the top level rows are measured ahead of time, the children are
+ * measured when they are loaded.
+ *
+ * It doesn't scale as well as the other strategies, but it is very reliable.
  */
 class Q_DECL_EXPORT AheadOfTime : public GeometryAdapter
 {
     Q_OBJECT
 public:
+    /// The ratio of the rows which have been measured (from 0 to 1)
+    Q_PROPERTY(qreal progress READ progress NOTIFY progressChanged)
+    /// If all rows have been measured
+    Q_PROPERTY(bool complete READ isComplete NOTIFY progressChanged)
+    /// The time (in ms) spent measuring per chunk before yielding
+    Q_PROPERTY(int budget READ budget WRITE setBudget)
+
     explicit AheadOfTime(Viewport *parent = nullptr);
     virtual ~AheadOfTime();
 
     Q_INVOKABLE virtual QSizeF sizeHint(const QModelIndex &index, AbstractItemAdapter *adapter) const override;
+
+    qreal progress() const;
+    bool isComplete() const;
+
+    int budget() const;
+    void setBudget(int ms);
+
+Q_SIGNALS:
+    void progressChanged();
+
+private:
+    AheadOfTimeStrategiesPrivate *d_ptr;
 };
 
 }
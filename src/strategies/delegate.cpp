@@ -17,21 +17,44 @@
  **************************************************************************/
 #include "delegate.h"
 
+// KQuickItemViews
+#include <viewport.h>
 #include <adapters/abstractitemadapter.h>
+#include <private/delegatemeasurer_p.h>
 #include <private/statetracker/viewitem_p.h>
 
-GeometryStrategies::Delegate::Delegate(Viewport *parent) : GeometryAdapter(parent)
+class DelegateStrategiesPrivate
 {
-    setCapabilities(Capabilities::REQUIRES_SINGLE_INSTANCE);
+public:
+    explicit DelegateStrategiesPrivate(Viewport *v) : m_Measurer(v) {}
+
+    DelegateMeasurer m_Measurer;
+};
+
+GeometryStrategies::Delegate::Delegate(Viewport *parent) : GeometryAdapter(parent),
+    d_ptr(new DelegateStrategiesPrivate(parent))
+{
+    setCapabilities(
+        Capabilities::REQUIRES_SINGLE_INSTANCE |
+        Capabilities::HAS_AHEAD_OF_TIME        |
+        Capabilities::ALWAYS_HAS_SIZE_HINTS
+    );
 }
 
 GeometryStrategies::Delegate::~Delegate()
-{}
+{
+    delete d_ptr;
+}
 
 QSizeF GeometryStrategies::Delegate::sizeHint(const QModelIndex &index, AbstractItemAdapter *adapter) const
 {
-    Q_UNUSED(index)
-    Q_ASSERT(adapter);
-    Q_ASSERT(false);
-    return {};
+    // The row has its own delegate, don't bind the measuring instance to it
+    // too. While it is a placeholder (see LoadingAdapter), measure it.
+    if (adapter && adapter->hasContent())
+        return adapter->s_ptr->currentGeometry().size();
+
+    if (!viewport())
+        return {};
+
+    return d_ptr->m_Measurer.measure(index);
 }
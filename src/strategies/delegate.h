@@ -20,12 +20,17 @@
 
 #include <adapters/geometryadapter.h>
 class Viewport;
+class DelegateStrategiesPrivate;
 
 namespace GeometryStrategies
 {
 
 /**
+ * Measure the rows using a single hidden delegate instance.
  *
+ * The instance is rebound to each row which needs to be measured (see
+ * DelegateMeasurer). This way, the size of the rows is known before their
+ * delegate is created, without keeping anything per row.
  */
 class Q_DECL_EXPORT Delegate : public GeometryAdapter
 {
@@ -35,6 +40,9 @@ public:
     virtual ~Delegate();
 
     Q_INVOKABLE virtual QSizeF sizeHint(const QModelIndex &index, AbstractItemAdapter *adapter) const override;
+
+private:
+    DelegateStrategiesPrivate *d_ptr;
 };
 
 }
@@ -17,38 +17,115 @@
  **************************************************************************/
 #include "role.h"
 
+// Qt
+#include <QtCore/QAbstractItemModel>
 #include <QtCore/QModelIndex>
 #include <QtCore/QRectF>
-#include <QtCore/QHash>
+#include <QtCore/QMap>
+#include <QtCore/QVector>
+
+// LibStdC++
+#include <algorithm>
 
 // KQuickItemViews
 #include <viewport.h>
 #include <adapters/modeladapter.h>
+#include <private/viewport_p.h>
 
-class RoleStrategiesPrivate
+class RoleStrategiesPrivate : public QObject
 {
+    Q_OBJECT
 public:
+    explicit RoleStrategiesPrivate(GeometryStrategies::Role *q);
+
+    struct Entry {
+        QSizeF  m_Size     {};
+        QPointF m_Position {};
+    };
+
+    /**
+     * The cached hints of the rows of a parent.
+     *
+     * Only the rows which were fetched are in the maps. They are indexed by
+     * row rather than by QPersistentModelIndex so the model doesn't have to
+     * update anything for them when it changes.
+     */
+    struct Rows final {
+        Rows() = default;
+        Rows(const Rows&) = delete;
+        Rows& operator=(const Rows&) = delete;
+        ~Rows() { qDeleteAll(m_hChildren); }
+
+        QMap<int, Entry> m_hEntries;
+        QMap<int, Rows*> m_hChildren;
+    };
+
     bool    m_Reload           {       true       };
     int     m_SizeRole         { Qt::SizeHintRole };
     int     m_PositionRole     {        -1        };
+    int     m_BatchSize        {        32        };
+    int     m_MaxEntries       {       1024       };
     QString m_SizeRoleName     {    "sizeHint"    };
     QString m_PositionRoleName {                  };
 
+    QAbstractItemModel *m_pModel {nullptr};
+
+    Rows m_Root;
+
+    /// The rows being moved between rowsAboutToBeMoved and rowsMoved
+    QMap<int, Entry> m_hMovedEntries;
+    QMap<int, Rows*> m_hMovedChildren;
+
+    QVector<QMetaObject::Connection> m_lConnections;
+
     void updateName();
+    void setModel(QAbstractItemModel *m);
+    Entry entry(const QModelIndex &index);
+    Entry load(const QModelIndex &index) const;
+    void fetch(const QModelIndex &parent, Rows *r, int row);
+    Rows *rows(const QModelIndex &parent, bool create);
+    bool isCachedRole(const QVector<int> &roles) const;
+
+    template<typename T>
+    static void shift(QMap<int, T> &map, int from, int offset);
+    template<typename T>
+    static QMap<int, T> take(QMap<int, T> &map, int first, int last);
+
+    static QSizeF  toSize    (const QVariant &v);
+    static QPointF toPosition(const QVariant &v);
 
     GeometryStrategies::Role *q_ptr;
+
+public Q_SLOTS:
+    void slotReset();
+    void slotRowsInserted(const QModelIndex &parent, int first, int last);
+    void slotRowsRemoved(const QModelIndex &parent, int first, int last);
+    void slotRowsAboutToBeMoved(const QModelIndex &p, int start, int end);
+    void slotRowsMoved(const QModelIndex &p, int start, int end, const QModelIndex &dest, int row);
+    void slotDataChanged(const QModelIndex &tl, const QModelIndex &br, const QVector<int> &roles);
 };
 
+RoleStrategiesPrivate::RoleStrategiesPrivate(GeometryStrategies::Role *q) :
+    QObject(q), q_ptr(q)
+{}
+
 GeometryStrategies::Role::Role(Viewport *parent) : GeometryAdapter(parent),
-    d_ptr(new RoleStrategiesPrivate())
+    d_ptr(new RoleStrategiesPrivate(this))
 {
-    d_ptr->q_ptr = this;
     setCapabilities(Capabilities::HAS_AHEAD_OF_TIME);
+
+    if (!parent)
+        return;
+
+    QObject::connect(parent->modelAdapter(), &ModelAdapter::modelChanged,
+        d_ptr, &RoleStrategiesPrivate::setModel);
+
+    d_ptr->setModel(parent->modelAdapter()->rawModel());
 }
 
 GeometryStrategies::Role::~Role()
 {
-    delete d_ptr;
+    // d_ptr is a QObject child
 }
 
 QSizeF GeometryStrategies::Role::sizeHint(const QModelIndex &index, AbstractItemAdapter *adapter) const
@@ -58,36 +135,17 @@ QSizeF GeometryStrategies::Role::sizeHint(const QModelIndex &index, AbstractItem
     if (d_ptr->m_Reload)
         d_ptr->updateName();
 
-    const auto val = index.data(d_ptr->m_SizeRole);
-    Q_ASSERT(val.isValid());
-
-    if (val.type() == QMetaType::QRectF) {
-        const QRectF rect = val.toRectF();
-
-        return rect.size();
-    }
-
-    Q_ASSERT(val.toSizeF().isValid());
-
-    return val.toSizeF();
+    return d_ptr->entry(index).m_Size;
 }
 
 QPointF GeometryStrategies::Role::positionHint(const QModelIndex &index, AbstractItemAdapter *adapter) const
 {
     Q_UNUSED(adapter)
+
     if (d_ptr->m_Reload)
         d_ptr->updateName();
 
-    const auto val = index.data(d_ptr->m_SizeRole);
-    Q_ASSERT(val.isValid());
-
-    if (val.type() == QMetaType::QRectF) {
-        const QRectF rect = val.toRectF();
-
-        return rect.topLeft();
-    }
-
-    return val.toPointF();
+    return d_ptr->entry(index).m_Position;
 }
 
 int GeometryStrategies::Role::sizeRole() const
@@ -97,8 +155,11 @@ int GeometryStrategies::Role::sizeRole() const
 
 void GeometryStrategies::Role::setSizeRole(int role)
 {
+    if (d_ptr->m_SizeRole == role)
+        return;
+
     d_ptr->m_SizeRole = role;
-    d_ptr->updateName();
+    d_ptr->slotReset();
     emit roleChanged();
 }
 
@@ -128,8 +189,11 @@ void GeometryStrategies::Role::setPositionRole(int role)
         Capabilities::HAS_AHEAD_OF_TIME | Capabilities::HAS_POSITION_HINTS
     );
 
+    if (d_ptr->m_PositionRole == role)
+        return;
+
     d_ptr->m_PositionRole = role;
-    d_ptr->updateName();
+    d_ptr->slotReset();
     emit roleChanged();
 }
 
@@ -151,26 +215,306 @@ void GeometryStrategies::Role::setPositionRoleName(const QString& roleName)
 void RoleStrategiesPrivate::updateName()
 {
     //TODO set the role name from the role index
-    const auto ma = q_ptr->viewport()->modelAdapter();
-
-    if (!ma->rawModel()) {
+    if ((!q_ptr->viewport()) || !q_ptr->viewport()->modelAdapter()->rawModel()) {
         m_Reload = true;
         return;
     }
 
-    const auto rn  = ma->rawModel()->roleNames();
+    const auto rn  = q_ptr->viewport()->modelAdapter()->rawModel()->roleNames();
     const auto rnv = rn.values();
 
     const QByteArray srn = m_SizeRoleName.toLatin1();
     const QByteArray prn = m_PositionRoleName.toLatin1();
 
-    if ((!srn.isEmpty()) && ma->rawModel() && rnv.contains(srn)) {
+    // Don't use the setters, they would call this again
+    m_Reload = false;
+
+    if ((!srn.isEmpty()) && rnv.contains(srn))
         q_ptr->setSizeRole(rn.key(srn));
-    }
 
-    if ((!prn.isEmpty()) && ma->rawModel() && rnv.contains(prn)) {
+    if ((!prn.isEmpty()) && rnv.contains(prn))
         q_ptr->setPositionRole(rn.key(prn));
+}
+
+void RoleStrategiesPrivate::setModel(QAbstractItemModel *m)
+{
+    for (const auto &c : qAsConst(m_lConnections))
+        QObject::disconnect(c);
+
+    m_lConnections.clear();
+
+    m_pModel = m;
+    m_Reload = true;
+
+    if (m) {
+        m_lConnections
+            << connect(m, &QAbstractItemModel::rowsInserted,
+                this, &RoleStrategiesPrivate::slotRowsInserted)
+            << connect(m, &QAbstractItemModel::rowsRemoved,
+                this, &RoleStrategiesPrivate::slotRowsRemoved)
+            << connect(m, &QAbstractItemModel::rowsAboutToBeMoved,
+                this, &RoleStrategiesPrivate::slotRowsAboutToBeMoved)
+            << connect(m, &QAbstractItemModel::rowsMoved,
+                this, &RoleStrategiesPrivate::slotRowsMoved)
+            << connect(m, &QAbstractItemModel::dataChanged,
+                this, &RoleStrategiesPrivate::slotDataChanged)
+            << connect(m, &QAbstractItemModel::modelReset,
+                this, &RoleStrategiesPrivate::slotReset)
+            << connect(m, &QAbstractItemModel::layoutChanged,
+                this, &RoleStrategiesPrivate::slotReset);
     }
 
-    m_Reload = false;
+    slotReset();
+}
+
+QSizeF RoleStrategiesPrivate::toSize(const QVariant &v)
+{
+    Q_ASSERT(v.isValid());
+
+    if (v.type() == QMetaType::QRectF)
+        return v.toRectF().size();
+
+    Q_ASSERT(v.toSizeF().isValid());
+
+    return v.toSizeF();
+}
+
+QPointF RoleStrategiesPrivate::toPosition(const QVariant &v)
+{
+    Q_ASSERT(v.isValid());
+
+    if (v.type() == QMetaType::QRectF)
+        return v.toRectF().topLeft();
+
+    return v.toPointF();
+}
+
+/**
+ * Get the hints of a row from the cache, fetch them (and the rows after it)
+ * if they are not cached.
+ *
+ * Each model access can be expensive when the data lives in a database or on
+ * a server. The rows are loaded in ranges when they enter the view, so
+ * fetching the following rows in the same batch avoids a round trip for each.
+ */
+RoleStrategiesPrivate::Entry RoleStrategiesPrivate::entry(const QModelIndex &index)
+{
+    if (!index.isValid())
+        return {};
+
+    // It isn't from the tracked model, so it can't be cached
+    if (index.model() != m_pModel)
+        return load(index);
+
+    const auto parent = index.parent();
+
+    auto r = rows(parent, true);
+
+    const auto it = r->m_hEntries.constFind(index.row());
+
+    if (it != r->m_hEntries.constEnd())
+        return *it;
+
+    fetch(parent, r, index.row());
+
+    return r->m_hEntries.value(index.row());
+}
+
+RoleStrategiesPrivate::Entry RoleStrategiesPrivate::load(const QModelIndex &index) const
+{
+    // The position role is optional, the size role can also be a QRectF
+    const int posRole = m_PositionRole >= 0 ? m_PositionRole : m_SizeRole;
+
+    const auto size = index.data(m_SizeRole);
+    const auto pos  = posRole == m_SizeRole ? size : index.data(posRole);
+
+    return { toSize(size), toPosition(pos) };
+}
+
+void RoleStrategiesPrivate::fetch(const QModelIndex &parent, Rows *r, int row)
+{
+    const int last = std::min(row + m_BatchSize, m_pModel->rowCount(parent)) - 1;
+
+    for (int i = row; i <= last; i++) {
+        if (!r->m_hEntries.contains(i))
+            r->m_hEntries[i] = load(m_pModel->index(i, 0, parent));
+    }
+
+    // Only keep the rows around the ones being loaded, drop the farthest
+    while (r->m_hEntries.size() > m_MaxEntries) {
+        const auto first = r->m_hEntries.begin();
+        const auto back  = r->m_hEntries.end() - 1;
+
+        r->m_hEntries.erase(row - first.key() > back.key() - row ? first : back);
+    }
 }
+
+/// Find the cached rows of `parent` from the path of rows leading to it
+RoleStrategiesPrivate::Rows *RoleStrategiesPrivate::rows(const QModelIndex &parent, bool create)
+{
+    QVector<int> path;
+
+    for (auto i = parent; i.isValid(); i = i.parent())
+        path.prepend(i.row());
+
+    auto r = &m_Root;
+
+    for (int row : qAsConst(path)) {
+        auto it = r->m_hChildren.find(row);
+
+        if (it == r->m_hChildren.end()) {
+            if (!create)
+                return nullptr;
+
+            it = r->m_hChildren.insert(row, new Rows);
+        }
+
+        r = *it;
+    }
+
+    return r;
+}
+
+bool RoleStrategiesPrivate::isCachedRole(const QVector<int> &roles) const
+{
+    return roles.isEmpty()
+        || roles.contains(m_SizeRole)
+        || (m_PositionRole >= 0 && roles.contains(m_PositionRole));
+}
+
+/// Add `offset` to the rows from `from` onward
+template<typename T>
+void RoleStrategiesPrivate::shift(QMap<int, T> &map, int from, int offset)
+{
+    QMap<int, T> shifted;
+
+    for (auto it = map.lowerBound(from); it != map.end();) {
+        shifted.insert(it.key() + offset, *it);
+        it = map.erase(it);
+    }
+
+    for (auto it = shifted.constBegin(); it != shifted.constEnd(); ++it)
+        map.insert(it.key(), *it);
+}
+
+/// Remove the rows [first, last], they are returned relative to `first`
+template<typename T>
+QMap<int, T> RoleStrategiesPrivate::take(QMap<int, T> &map, int first, int last)
+{
+    QMap<int, T> ret;
+
+    for (auto it = map.lowerBound(first); it != map.end() && it.key() <= last;) {
+        ret.insert(it.key() - first, *it);
+        it = map.erase(it);
+    }
+
+    shift(map, last + 1, first - last - 1);
+
+    return ret;
+}
+
+void RoleStrategiesPrivate::slotReset()
+{
+    qDeleteAll(m_Root.m_hChildren);
+    m_Root.m_hChildren.clear();
+    m_Root.m_hEntries.clear();
+}
+
+void RoleStrategiesPrivate::slotRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    // It will be fetched on the first access
+    auto r = rows(parent, false);
+
+    if (!r)
+        return;
+
+    shift(r->m_hEntries, first, last - first + 1);
+    shift(r->m_hChildren, first, last - first + 1);
+}
+
+void RoleStrategiesPrivate::slotRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    auto r = rows(parent, false);
+
+    if (!r)
+        return;
+
+    take(r->m_hEntries, first, last);
+    qDeleteAll(take(r->m_hChildren, first, last));
+}
+
+/// Take the moved rows out, the paths to the destination are then the new ones
+void RoleStrategiesPrivate::slotRowsAboutToBeMoved(const QModelIndex &p, int start, int end)
+{
+    auto r = rows(p, false);
+
+    if (!r)
+        return;
+
+    m_hMovedEntries  = take(r->m_hEntries, start, end);
+    m_hMovedChildren = take(r->m_hChildren, start, end);
+}
+
+void RoleStrategiesPrivate::slotRowsMoved(const QModelIndex &p, int start, int end, const QModelIndex &dest, int row)
+{
+    const int count = end - start + 1;
+
+    // The destination row is from before the source rows were removed
+    const int to = (p == dest && row > end) ? row - count : row;
+
+    const bool hasMoved = !(m_hMovedEntries.isEmpty() && m_hMovedChildren.isEmpty());
+
+    if (auto r = rows(dest, hasMoved)) {
+        shift(r->m_hEntries, to, count);
+        shift(r->m_hChildren, to, count);
+
+        for (auto it = m_hMovedEntries.constBegin(); it != m_hMovedEntries.constEnd(); ++it)
+            r->m_hEntries.insert(to + it.key(), *it);
+
+        for (auto it = m_hMovedChildren.constBegin(); it != m_hMovedChildren.constEnd(); ++it)
+            r->m_hChildren.insert(to + it.key(), *it);
+    }
+
+    m_hMovedEntries.clear();
+    m_hMovedChildren.clear();
+}
+
+/**
+ * Drop the cached hints and tell the view the loaded rows have to be
+ * measured again.
+ *
+ * The loaded rows were all measured when they were loaded, so only the
+ * cached ones have to be looked at.
+ */
+void RoleStrategiesPrivate::slotDataChanged(const QModelIndex &tl, const QModelIndex &br, const QVector<int> &roles)
+{
+    // Only the changes to the hints matter
+    if (!isCachedRole(roles))
+        return;
+
+    auto r = rows(tl.parent(), false);
+
+    if (!r)
+        return;
+
+    const auto vp = q_ptr->viewport();
+    const auto parent = tl.parent();
+
+    bool changed = false;
+
+    for (auto it = r->m_hEntries.lowerBound(tl.row()); it != r->m_hEntries.end() && it.key() <= br.row();) {
+        if (vp) {
+            if (auto md = vp->s_ptr->metadataForIndex(m_pModel->index(it.key(), 0, parent))) {
+                vp->s_ptr->notifyChange(md);
+                changed = true;
+            }
+        }
+
+        it = r->m_hEntries.erase(it);
+    }
+
+    if (changed)
+        vp->s_ptr->refreshVisible();
+}
+
+#include <role.moc>
@@ -17,24 +17,109 @@
  **************************************************************************/
 #include "uniform.h"
 
+// Qt
+#include <QtCore/QTimer>
+
+// KQuickItemViews
+#include <viewport.h>
+#include <viewbase.h>
+#include <adapters/modeladapter.h>
 #include <adapters/abstractitemadapter.h>
 #include <private/statetracker/viewitem_p.h>
 
-GeometryStrategies::Uniform::Uniform(Viewport *parent) : GeometryAdapter(parent)
+class UniformStrategiesPrivate : public QObject
+{
+    Q_OBJECT
+public:
+    explicit UniformStrategiesPrivate(GeometryStrategies::Uniform *q) :
+        QObject(q), q_ptr(q) {}
+
+    QSizeF m_Size {};
+
+    GeometryStrategies::Uniform *q_ptr;
+
+public Q_SLOTS:
+    void slotReset();
+    void slotUpdateCapabilities();
+};
+
+GeometryStrategies::Uniform::Uniform(Viewport *parent) : GeometryAdapter(parent),
+    d_ptr(new UniformStrategiesPrivate(this))
 {
     setCapabilities(
         Capabilities::HAS_UNIFORM_HEIGHT |
         Capabilities::HAS_UNIFORM_WIDTH
     );
+
+    if (!parent)
+        return;
+
+    // The measured delegate is no longer representative
+    QObject::connect(parent->modelAdapter(), &ModelAdapter::modelChanged,
+        d_ptr, &UniformStrategiesPrivate::slotReset);
+
+    QObject::connect(parent->modelAdapter(), &ModelAdapter::delegateChanged,
+        d_ptr, &UniformStrategiesPrivate::slotReset);
+
+    if (auto v = parent->modelAdapter()->view())
+        QObject::connect(v, &QQuickItem::widthChanged,
+            d_ptr, &UniformStrategiesPrivate::slotReset);
 }
 
 GeometryStrategies::Uniform::~Uniform()
-{}
+{
+    // d_ptr is a QObject child
+}
 
 QSizeF GeometryStrategies::Uniform::sizeHint(const QModelIndex &index, AbstractItemAdapter *adapter) const
 {
     Q_UNUSED(index)
-    Q_ASSERT(adapter);
-    Q_ASSERT(false);
-    return {};
+
+    if (!d_ptr->m_Size.isEmpty())
+        return d_ptr->m_Size;
+
+    // There is nothing to measure yet
+    if (!adapter)
+        return {};
+
+    const auto ret = adapter->s_ptr->currentGeometry().size();
+
+    // A 0x0 delegate is probably not laid out yet, try again with the next one
+    if (ret.isEmpty())
+        return ret;
+
+    d_ptr->m_Size = ret;
+
+    // The capabilities are used by the layout which is calling this, don't
+    // change them in the middle of it.
+    QTimer::singleShot(0, d_ptr, &UniformStrategiesPrivate::slotUpdateCapabilities);
+
+    return ret;
+}
+
+/// Measure the next delegate again
+void UniformStrategiesPrivate::slotReset()
+{
+    m_Size = {};
+    slotUpdateCapabilities();
+
+    emit q_ptr->dismissResult();
 }
+
+/**
+ * Once the size is known, the delegates are no longer needed to know the
+ * size of the other elements.
+ */
+void UniformStrategiesPrivate::slotUpdateCapabilities()
+{
+    static constexpr const int flags =
+        GeometryAdapter::Capabilities::ALWAYS_HAS_SIZE_HINTS |
+        GeometryAdapter::Capabilities::HAS_AHEAD_OF_TIME;
+
+    if (m_Size.isEmpty())
+        q_ptr->removeCapabilities(flags);
+    else
+        q_ptr->addCapabilities(flags);
+}
+
+#include <uniform.moc>
@@ -20,12 +20,18 @@
 
 #include <adapters/geometryadapter.h>
 class Viewport;
+class UniformStrategiesPrivate;
 
 namespace GeometryStrategies
 {
 
 /**
+ * A GeometryAdapter for views where all elements have the same size.
  *
+ * The first delegate is measured, then its size is used for all the other
+ * elements. Once this is done, the size (and position) of any row is known
+ * before its delegate is created. It is measured again when the delegate,
+ * the model or the width of the view changes.
  */
 class Q_DECL_EXPORT Uniform : public GeometryAdapter
 {
@@ -35,6 +41,10 @@ public:
     virtual ~Uniform();
 
     Q_INVOKABLE virtual QSizeF sizeHint(const QModelIndex &index, AbstractItemAdapter *adapter) const override;
+
+private:
+    UniformStrategiesPrivate *d_ptr;
+    friend class UniformStrategiesPrivate; // Update the capabilities
 };
 
 }
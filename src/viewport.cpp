@@ -22,6 +22,10 @@
 #include <QQmlEngine>
 #include <QQmlContext>
 
+// LibStdC++
+#include <algorithm>
+#include <cmath>
+
 // KQuickItemViews
 #include "private/viewport_p.h"
 #include "proxies/sizehintproxymodel.h"
@@ -49,6 +53,9 @@ public:
     QRectF m_ViewRect;
     QRectF m_UsedRect;
 
+    // If the bottom of the content is visible (see ViewBase::gravity)
+    bool m_IsPinned {true};
+
     void updateAvailableEdges();
 
     Viewport *q_ptr;
@@ -57,6 +64,7 @@ public Q_SLOTS:
     void slotModelChanged(QAbstractItemModel* m, QAbstractItemModel* o);
     void slotModelAboutToChange(QAbstractItemModel* m, QAbstractItemModel* o);
     void slotViewportChanged(const QRectF &viewport);
+    void slotContentYChanged();
 };
 
 Viewport::Viewport(ModelAdapter* ma) : QObject(),
@@ -74,7 +82,10 @@ Viewport::Viewport(ModelAdapter* ma) : QObject(),
         d_ptr, &ViewportPrivate::slotModelChanged);
     connect(ma->view(), &Flickable::viewportChanged,
         d_ptr, &ViewportPrivate::slotViewportChanged);
+    connect(ma->view(), &Flickable::contentYChanged,
+        d_ptr, &ViewportPrivate::slotContentYChanged);
     connect(ma, &ModelAdapter::delegateChanged, s_ptr->m_pReflector, [this]() {
+        s_ptr->clearPool();
         s_ptr->m_pReflector->modelTracker()->performAction(
             StateTracker::Model::Action::RESET
         );
@@ -88,6 +99,7 @@ Viewport::Viewport(ModelAdapter* ma) : QObject(),
 
 Viewport::~Viewport()
 {
+    s_ptr->clearPool();
     delete s_ptr;
     delete d_ptr;
 }
@@ -105,10 +117,15 @@ void ViewportPrivate::slotModelAboutToChange(QAbstractItemModel* m, QAbstractIte
 void ViewportPrivate::slotModelChanged(QAbstractItemModel* m, QAbstractItemModel* o)
 {
     Q_UNUSED(o)
+    m_pModelAdapter->view()->setOriginY(0);
     m_pModelAdapter->view()->setContentY(0);
+    m_IsPinned = true;
 
     q_ptr->s_ptr->m_pReflector->modelTracker()->setModel(m);
 
+    // The roles may be different, so the contexts can't be reused
+    q_ptr->s_ptr->clearPool();
+
     Q_ASSERT(m_pModelAdapter->rawModel() == m);
 
     q_ptr->s_ptr->m_pGeoAdapter->setModel(m);
@@ -129,6 +146,14 @@ void ViewportPrivate::slotViewportChanged(const QRectF &viewport)
     q_ptr->s_ptr->m_pReflector->modelTracker() << StateTracker::Model::Action::MOVE;
 }
 
+void ViewportPrivate::slotContentYChanged()
+{
+    const auto v = m_pModelAdapter->view();
+
+    // Stay pinned as long as the end of the content is visible
+    m_IsPinned = v->contentY() + v->height() >= v->originY() + v->contentHeight() - 1.0;
+}
+
 ModelAdapter *Viewport::modelAdapter() const
 {
     return d_ptr->m_pModelAdapter;
@@ -149,7 +174,21 @@ QSizeF Viewport::totalSize() const
     if ((!d_ptr->m_pModelAdapter->delegate()) || !d_ptr->m_pModelAdapter->rawModel())
         return {0.0, 0.0};
 
-    return {}; //TODO
+    // Only the top level rows are counted, the children are assumed collapsed
+    if (const qreal h = s_ptr->uniformHeight()) {
+        return {
+            d_ptr->m_UsedRect.width(),
+            d_ptr->m_pModelAdapter->rawModel()->rowCount() * h
+        };
+    }
+
+    // Nothing was measured yet, there is nothing to extrapolate from
+    if (!s_ptr->m_Extents.knownCount())
+        return {};
+
+    const auto edges = s_ptr->contentEdges();
+
+    return {d_ptr->m_UsedRect.width(), edges.second - edges.first};
 }
 
 void Viewport::setItemFactory(ViewBase::ItemFactoryBase *factory)
@@ -174,6 +213,10 @@ void ViewportPrivate::updateAvailableEdges()
     if (!q_ptr->s_ptr->m_pReflector->modelTracker()->modelCandidate())
         return;
 
+    // Flip the elements which entered or left the viewport first, the edges
+    // depend on it.
+    q_ptr->s_ptr->updateVisibility();
+
     Qt::Edges available;
 
     auto v = m_pModelAdapter->view();
@@ -190,39 +233,71 @@ void ViewportPrivate::updateAvailableEdges()
 
     Q_ASSERT((!bve) || (!bve->down()) || (!bve->down()->isVisible()));
 
+    // The ends of the loaded elements (visible or not)
+    auto tbe = q_ptr->s_ptr->m_pReflector->getEdge(
+        IndexMetadata::EdgeType::BUFFERED, Qt::TopEdge
+    );
+
+    auto bbe = q_ptr->s_ptr->m_pReflector->getEdge(
+        IndexMetadata::EdgeType::BUFFERED, Qt::BottomEdge
+    );
+
     // If they don't have a valid size, then there is a bug elsewhere
     Q_ASSERT((!tve) || tve->isValid());
     Q_ASSERT((!bve) || tve->isValid());
 
     // Do not attempt to load the geometry yet, let the loading code do it later
-    const bool tveValid = tve && tve->isValid();
-    const bool bveValid = bve && bve->isValid();
+    const bool tbeValid = tbe && tbe->isValid();
 
     // Given 42x0 sized item are possible. However just "fixing" this by adding
     // a minimum size wont help because it will trigger the out of sync view
     // correction in an infinite loop.
-    QRectF tvg(tve?tve->decoratedGeometry():QRectF()), bvg(bve?bve->decoratedGeometry():QRectF());
-
-    const auto fixedIntersect = [](bool valid, QRectF& vp, QRectF& geo) -> bool {
-        Q_UNUSED(valid) //TODO
-        return vp.intersects(geo) || (
-            geo.y() >= vp.y() && geo.width() == 0 && geo.y() <= vp.y() + vp.height()
-        ) || (
-            geo.height() == 0 && geo.width() > 0  && geo.x() <= vp.x() + vp.width()
-            && geo.x() >= vp.x()
-        );
-    };
+    QRectF tbg(tbe?tbe->decoratedGeometry():QRectF()), bbg(bbe?bbe->decoratedGeometry():QRectF());
 
-    QRectF vp = m_ViewRect;
+    QRectF zone = q_ptr->s_ptr->bufferRect();
 
     // Add an extra pixel to the height to prevent off-by-one where the view is
     // perfectly full and can't scroll any more (and thus load the next item)
-    vp.setHeight(vp.height()+1.0);
+    zone.setHeight(zone.height()+1.0);
+
+    // Count the loaded elements outside of the viewport, up to `buffer`
+    const int buffer = m_pModelAdapter->cacheBuffer();
+
+    const auto outside = [this, buffer](IndexMetadata *i, Qt::Edge e) -> int {
+        int ret = 0;
+
+        while (i && ret < buffer && i->isValid() && !i->isVisible()) {
+            const auto geo = i->decoratedGeometry();
 
-    if ((!tve) || (fixedIntersect(tveValid, vp, tvg) && tvg.y() > 0))
+            if (e == Qt::TopEdge ? geo.bottom() > m_ViewRect.y() : geo.y() < m_ViewRect.bottom())
+                break;
+
+            ret++;
+            i = e == Qt::TopEdge ? i->down() : i->up();
+        }
+
+        return ret;
+    };
+
+    if ((!tbe) || ((!tbe->isTopItem()) && (
+        tbg.y() > zone.y() || outside(tbe, Qt::TopEdge) < buffer)))
         available |= Qt::TopEdge;
 
-    if ((!bve) || fixedIntersect(bveValid, vp, bvg))
+    // The content begins at the top item. When it isn't loaded, it begins
+    // where the rows above are estimated to end. The loaded elements keep
+    // their position when the estimates change, only the origin moves, so
+    // contentY never jumps. It is never moved below the viewport, the error
+    // is absorbed as the rows above are loaded instead.
+    if (tbeValid && tbe->isTopItem())
+        v->setOriginY(tbg.y());
+    else if (tbeValid && q_ptr->totalSize().isValid())
+        v->setOriginY(std::min({
+            q_ptr->s_ptr->contentEdges().first, tbg.y(), v->contentY()
+        }));
+    else if (tbeValid && tbg.y() < v->originY())
+        v->setOriginY(tbg.y());
+
+    if ((!bbe) || bbg.bottom() < zone.bottom() || outside(bbe, Qt::BottomEdge) < buffer)
         available |= Qt::BottomEdge;
 
     q_ptr->s_ptr->m_pReflector->setAvailableEdges(
@@ -257,20 +332,36 @@ void ViewportPrivate::updateAvailableEdges()
     Q_ASSERT((!bve) || (!bve->down()) || (!bve->down()->isVisible()));
     //END test
 
+    // Trimming may have unloaded it
+    bbe = q_ptr->s_ptr->m_pReflector->getEdge(
+        IndexMetadata::EdgeType::BUFFERED, Qt::BottomEdge
+    );
+
     // Size is normal as the state as not converged yet
-    Q_ASSERT((!bve) || (
-        bve->geometryTracker()->state() == StateTracker::Geometry::State::VALID ||
-        bve->geometryTracker()->state() == StateTracker::Geometry::State::SIZE)
+    Q_ASSERT((!bbe) || (
+        bbe->geometryTracker()->state() == StateTracker::Geometry::State::VALID ||
+        bbe->geometryTracker()->state() == StateTracker::Geometry::State::SIZE)
     );
 
     // Resize the contend height, it has to be done after the geometry has been
     // updated.
-    if (bve && q_ptr->s_ptr->m_pGeoAdapter->capabilities() & GeometryAdapter::Capabilities::TRACKS_QQUICKITEM_GEOMETRY) {
+    if (bbe && q_ptr->s_ptr->m_pGeoAdapter->capabilities() & GeometryAdapter::Capabilities::TRACKS_QQUICKITEM_GEOMETRY) {
+
+        const auto geo = bbe->decoratedGeometry();
 
-        const auto geo = bve->decoratedGeometry();
+        v->contentItem()->setHeight(std::max(
+            geo.y() + geo.height() - v->originY(), v->height()
+        ));
+
+        emit v->contentHeightChanged( v->contentItem()->height() );
+    }
+    else if (bbe && q_ptr->totalSize().isValid()) {
+        // Include the rows below the last element which are not loaded
+        const qreal bottom = q_ptr->s_ptr->contentEdges().second;
 
         v->contentItem()->setHeight(std::max(
-            geo.y()+geo.height(), v->height()
+            std::max(bottom, bbe->decoratedGeometry().bottom()) - v->originY(),
+            v->height()
         ));
 
         emit v->contentHeightChanged( v->contentItem()->height() );
@@ -278,6 +369,26 @@ void ViewportPrivate::updateAvailableEdges()
 
     if (oldTve != tve || oldBve != bve)
         emit q_ptr->cornerChanged();
+
+    // Keep the last element at the bottom of the viewport when rows are
+    // appended. This will update the edges again.
+    if (m_IsPinned && q_ptr->s_ptr->isBottomAnchored() && bbe && bbe->isValid())
+        v->setContentY(bbe->decoratedGeometry().bottom() - v->height());
+}
+
+/// If the content is loaded from the bottom (see ViewBase::gravity)
+bool ViewportSync::isBottomAnchored() const
+{
+    switch (q_ptr->modelAdapter()->view()->gravity()) {
+        case Qt::BottomLeftCorner:
+        case Qt::BottomRightCorner:
+            return true;
+        case Qt::TopLeftCorner:
+        case Qt::TopRightCorner:
+            break;
+    }
+
+    return false;
 }
 
 void ViewportSync::geometryUpdated(IndexMetadata *item)
@@ -294,6 +405,14 @@ void ViewportSync::geometryUpdated(IndexMetadata *item)
         q_ptr->d_ptr->updateAvailableEdges();
 }
 
+void ViewportSync::notifyExtentsChanged()
+{
+    if (m_pReflector->modelTracker()->state() == StateTracker::Model::State::RESETING)
+        return; //TODO it needs another state machine to get rid of the `if`
+
+    q_ptr->d_ptr->updateAvailableEdges();
+}
+
 void ViewportSync::updateGeometry(IndexMetadata* item)
 {
     if (m_pGeoAdapter->capabilities() & GeometryAdapter::Capabilities::TRACKS_QQUICKITEM_GEOMETRY)
@@ -359,20 +478,26 @@ void ViewportSync::refreshVisible()
     if (m_pReflector->modelTracker()->state() == StateTracker::Model::State::RESETING)
         return; //TODO it needs another state machine to get rid of the `if`
 
-    //TODO eventually move to a relative origin so moving an item to the top
-    // doesn't need to move everything
+    // It will be done once the transaction is committed
+    if (m_TransactionDepth) {
+        m_IsDirty = true;
+        return;
+    }
+
+    // The changes above the viewport grow the content upward (see reflowUp),
+    // so the elements below only move when they really have to.
 
+    // The buffered elements are positioned too, otherwise they could not be
+    // flipped to VISIBLE without a relayout (see updateVisibility).
     IndexMetadata *item = m_pReflector->getEdge(
-        IndexMetadata::EdgeType::VISIBLE, Qt::TopEdge
+        IndexMetadata::EdgeType::BUFFERED, Qt::TopEdge
     );
 
     if (!item)
         return;
 
-    Q_ASSERT((!item->up()) || !item->up()->isVisible());
-
     auto bve = m_pReflector->getEdge(
-        IndexMetadata::EdgeType::VISIBLE, Qt::BottomEdge
+        IndexMetadata::EdgeType::BUFFERED, Qt::BottomEdge
     );
 
     auto prev = item->up();
@@ -398,7 +523,7 @@ void ViewportSync::refreshVisible()
                 i->decoratedGeometry();
         }
         else
-            prev->setPosition({0.0, 0.0});
+            prev->setPosition({0.0, q_ptr->modelAdapter()->view()->originY()});
     }
 
     const bool hasSingleItem = item == bve;
@@ -416,18 +541,156 @@ void ViewportSync::refreshVisible()
         }
 
         item->sizeHint();
-        Q_ASSERT(item->isVisible());
         Q_ASSERT(item->isValid());
         //FIXME As of 0.1, this still fails from time to time
         //Q_ASSERT(item->isInSync());//TODO THIS_COMMIT
 
-        // This `performAction` exists to recover from runtime failures
-        if (!item->isInSync())
+        // This `performAction` exists to recover from runtime failures. The
+        // buffered delegates are synced when they become visible.
+        if (item->isVisible() && !item->isInSync())
             item << IndexMetadata::LoadAction::MOVE;
 
     } while((!hasSingleItem) && item->up() != bve && (item = item->down()));
 }
 
+bool ViewportSync::isInViewport(const QRectF &geometry) const
+{
+    const auto vp = q_ptr->currentRect();
+
+    // Until the view has a size, everything is visible
+    if (!vp.isValid())
+        return true;
+
+    // Empty elements are visible when they are within the viewport
+    if (geometry.height() == 0)
+        return geometry.y() >= vp.y() && geometry.y() <= vp.bottom();
+
+    return geometry.y() < vp.bottom() && geometry.bottom() > vp.y();
+}
+
+QRectF ViewportSync::bufferRect() const
+{
+    const qreal h = q_ptr->modelAdapter()->cacheBufferHeight();
+
+    return q_ptr->currentRect().adjusted(0, -h, 0, h);
+}
+
+/**
+ * Flip the loaded elements between the BUFFER and VISIBLE states after the
+ * viewport moved. Their delegates already exist, so this only toggles their
+ * visibility and applies the position of those entering the viewport.
+ *
+ * The VISIBLE range has to stay continuous (see ContentPrivate::growEdges),
+ * so the elements are hidden from its ends inward and shown from its ends
+ * outward. This is O(changed elements).
+ */
+void ViewportSync::updateVisibility()
+{
+    using LoadAction = IndexMetadata::LoadAction;
+    using EdgeType   = IndexMetadata::EdgeType;
+
+    // SHOW applies the position, which can update the edges again
+    if (m_IsUpdatingVisibility)
+        return;
+
+    m_IsUpdatingVisibility = true;
+
+    // Without a valid geometry, it isn't known yet, keep it as-is
+    const auto inView = [this](IndexMetadata *md) -> bool {
+        return md->isValid() && isInViewport(md->decoratedGeometry());
+    };
+
+    const auto outOfView = [this](IndexMetadata *md) -> bool {
+        return md->isValid() && !isInViewport(md->decoratedGeometry());
+    };
+
+    const auto isLoaded = [](IndexMetadata *md) -> bool {
+        return md->modelTracker()->state() == StateTracker::ModelItem::State::BUFFER
+            || md->isVisible();
+    };
+
+    // The moved elements are shown wherever they land (see
+    // ContentPrivate::slotRowsMoved), so they can be VISIBLE outside of the
+    // range. They have to be hidden first for the edges to grow over them.
+    const auto show = [](IndexMetadata *md) {
+        if (md->isVisible())
+            md << IndexMetadata::LoadAction::HIDE;
+
+        md << IndexMetadata::LoadAction::SHOW;
+    };
+
+    // Hide what left the viewport
+    while (auto i = m_pReflector->getEdge(EdgeType::VISIBLE, Qt::TopEdge)) {
+        if (!outOfView(i))
+            break;
+
+        i << LoadAction::HIDE;
+    }
+
+    while (auto i = m_pReflector->getEdge(EdgeType::VISIBLE, Qt::BottomEdge)) {
+        if (!outOfView(i))
+            break;
+
+        i << LoadAction::HIDE;
+    }
+
+    // When the viewport moved past all the visible elements (but is still
+    // within the buffer), start over from the first one it intersects.
+    if (!m_pReflector->getEdge(EdgeType::VISIBLE, Qt::TopEdge)) {
+        const auto last = m_pReflector->getEdge(EdgeType::BUFFERED, Qt::BottomEdge);
+
+        for (auto i = m_pReflector->getEdge(EdgeType::BUFFERED, Qt::TopEdge); i; i = i->down()) {
+            if (isLoaded(i) && inView(i)) {
+                show(i);
+                break;
+            }
+
+            if (i == last)
+                break;
+        }
+    }
+
+    // Then grow the range
+    while (auto i = m_pReflector->getEdge(EdgeType::VISIBLE, Qt::TopEdge)) {
+        const auto prev = i->up();
+
+        if (!(prev && isLoaded(prev) && inView(prev)))
+            break;
+
+        show(prev);
+    }
+
+    while (auto i = m_pReflector->getEdge(EdgeType::VISIBLE, Qt::BottomEdge)) {
+        const auto next = i->down();
+
+        if (!(next && isLoaded(next) && inView(next)))
+            break;
+
+        show(next);
+    }
+
+    m_IsUpdatingVisibility = false;
+}
+
+void ViewportSync::beginTransaction()
+{
+    m_TransactionDepth++;
+}
+
+void ViewportSync::commitTransaction()
+{
+    Q_ASSERT(m_TransactionDepth > 0);
+
+    if ((--m_TransactionDepth) || !m_IsDirty)
+        return;
+
+    m_IsDirty = false;
+
+    refreshVisible();
+
+    q_ptr->d_ptr->updateAvailableEdges();
+}
+
 void ViewportSync::notifyInsert(IndexMetadata* item)
 {
     using GeoState = StateTracker::Geometry::State;
@@ -439,12 +702,21 @@ void ViewportSync::notifyInsert(IndexMetadata* item)
     if (!item)
         return;
 
+    // Something was inserted or resized above the viewport, keep what is
+    // visible where it is and move what is above instead.
+    if (reflowUp(item)) {
+        refreshVisible();
+        q_ptr->d_ptr->updateAvailableEdges();
+        return;
+    }
+
     const bool needsPosition = item->geometryTracker()->state() == GeoState::INIT ||
       item->geometryTracker()->state() == GeoState::SIZE;
 
     // If the item is new and is inserted near valid items, skip some back and
     // forth and set the position now.
-    if (needsPosition && item->up() && item->up()->geometryTracker()->state() ==  GeoState::VALID) {
+    if (needsPosition && item->up() && item->up()->geometryTracker()->state() ==  GeoState::VALID
+      && !item->isAfterGap()) {
         item->setPosition(item->up()->decoratedGeometry().bottomLeft());
     }
 
@@ -454,7 +726,7 @@ void ViewportSync::notifyInsert(IndexMetadata* item)
     }
 
     auto bve = m_pReflector->getEdge(
-        IndexMetadata::EdgeType::VISIBLE, Qt::BottomEdge
+        IndexMetadata::EdgeType::BUFFERED, Qt::BottomEdge
     );
 
     //FIXME this is also horrible
@@ -477,6 +749,58 @@ void ViewportSync::notifyInsert(IndexMetadata* item)
     q_ptr->d_ptr->updateAvailableEdges();
 }
 
+/**
+ * Move the elements above `item` (which keeps its position) so they touch it.
+ *
+ * This is used when the elements above the viewport change. Otherwise
+ * prepending to a list (like a chat history) while looking at the bottom
+ * would move every visible delegate. The elements above the viewport are
+ * limited to the cacheBuffer (see Model::trim), so this is usually cheaper.
+ * Then the content origin moves by the same amount.
+ *
+ * @return If the change has been handled.
+ */
+bool ViewportSync::reflowUp(IndexMetadata *item)
+{
+    if (!item->isValid())
+        return false;
+
+    auto below = item->decoratedGeometry();
+
+    // The top of `item` has to be above the viewport. When it is exactly at
+    // the top, the new elements are expected to be visible.
+    if (below.y() >= q_ptr->currentRect().y())
+        return false;
+
+    qreal delta = 0;
+
+    for (auto prev = item, i = item->up(); i; prev = i, i = i->up()) {
+        // A word of warning, sizeHint is recursive when there is no position
+        if (!i->isValid())
+            i->sizeHint();
+
+        const auto geo = i->decoratedGeometry();
+
+        // The unloaded rows in between still have the same height, so it
+        // moves as much as the element below it
+        if (!prev->isAfterGap())
+            delta = below.y() - geo.height() - geo.y();
+
+        // Everything above is already in place
+        if (delta == 0.0)
+            return true;
+
+        i->setPosition({0.0, geo.y() + delta});
+
+        below = i->decoratedGeometry();
+    }
+
+    const auto v = q_ptr->modelAdapter()->view();
+    v->setOriginY(v->originY() + delta);
+
+    return true;
+}
+
 void Viewport::resize(const QRectF& rect)
 {
     if (s_ptr->m_pReflector->modelTracker()->state() == StateTracker::Model::State::RESETING)
@@ -542,6 +866,71 @@ QQmlComponent *ViewportSync::component()
     return m_pComponent;
 }
 
+int ViewportSync::poolKey(IndexMetadata *md) const
+{
+    return q_ptr->modelAdapter()->recyclingMode() == ModelAdapter::RecyclingMode::RecyclePerDepth ?
+        md->indexTracker()->depth() : 0;
+}
+
+AbstractItemAdapter *ViewportSync::takeFromPool(IndexMetadata *md)
+{
+    if (q_ptr->modelAdapter()->recyclingMode() == ModelAdapter::RecyclingMode::NoRecycling)
+        return nullptr;
+
+    const auto pool = m_hPool.find(poolKey(md));
+
+    if (pool == m_hPool.end() || pool->isEmpty()) {
+        m_PoolMisses++;
+        emit q_ptr->modelAdapter()->poolStatsChanged();
+        return nullptr;
+    }
+
+    m_PoolHits++;
+    emit q_ptr->modelAdapter()->poolStatsChanged();
+
+    const auto entry = pool->takeLast();
+
+    // This has to be done before the view tracker is set, it would otherwise
+    // create a new context.
+    md->setContextAdapter(entry.second);
+
+    return entry.first;
+}
+
+bool ViewportSync::addToPool(IndexMetadata *md, AbstractItemAdapter *item)
+{
+    const auto ma = q_ptr->modelAdapter();
+
+    if (ma->recyclingMode() == ModelAdapter::RecyclingMode::NoRecycling)
+        return false;
+
+    // The delegate or the model are being replaced, they can't be reused
+    if (m_pReflector->modelTracker()->state() == StateTracker::Model::State::RESETING)
+        return false;
+
+    auto &pool = m_hPool[poolKey(md)];
+
+    if (pool.size() >= ma->poolSize())
+        return false;
+
+    pool << qMakePair(item, md->takeContextAdapter());
+
+    return true;
+}
+
+void ViewportSync::clearPool()
+{
+    const auto pools = m_hPool;
+    m_hPool.clear();
+
+    for (const auto &pool : qAsConst(pools)) {
+        for (const auto &entry : qAsConst(pool)) {
+            entry.first->s_ptr->performAction(IndexMetadata::ViewAction::DETACH);
+            delete entry.second;
+        }
+    }
+}
+
 GeometryAdapter *Viewport::geometryAdapter() const
 {
     return s_ptr->m_pGeoAdapter;
@@ -552,9 +941,42 @@ void Viewport::setGeometryAdapter(GeometryAdapter *a)
     s_ptr->m_pGeoAdapter->setCurrentAdapter(a);
 }
 
+/// The point is in content coordinates, like itemRect()
 QModelIndex Viewport::indexAt(const QPoint &point) const
 {
-    return {}; //TODO
+    const auto first = s_ptr->m_pReflector->firstItem();
+    const auto last  = s_ptr->m_pReflector->lastItem ();
+
+    const bool isLoaded = first && last && first->metadata()->isValid()
+        && last->metadata()->isValid();
+
+    const auto bottom = isLoaded ?
+        last->metadata()->decoratedGeometry().bottom() : 0;
+
+    // Use the loaded elements when possible, they are always right
+    if (isLoaded && point.y() >= first->metadata()->decoratedGeometry().y() && point.y() < bottom) {
+        const auto i = s_ptr->m_pReflector->root()->childrenLowerBound(
+            s_ptr->rowAt(point.y())
+        );
+
+        auto md = (i ? i : first)->metadata();
+
+        // The children are not part of the extents, so it can be a bit off
+        while (md->up() && md->up()->isValid() && md->decoratedGeometry().y() > point.y())
+            md = md->up();
+
+        while (md->down() && md->down()->isValid() && md->down()->decoratedGeometry().y() <= point.y())
+            md = md->down();
+
+        return md->index();
+    }
+
+    const int row = s_ptr->rowAt(point.y());
+
+    if (row < 0 || !modelAdapter()->rawModel())
+        return {};
+
+    return modelAdapter()->rawModel()->index(row, 0);
 }
 
 QModelIndex Viewport::indexAt(Qt::Corner corner) const
@@ -585,9 +1007,91 @@ QRectF Viewport::itemRect(const QModelIndex& i) const
     if (auto md = s_ptr->m_pReflector->metadataForIndex(i))
         return md->decoratedGeometry();
 
-    //TODO load it
+    // Only the top level rows are tracked when they are not loaded
+    if ((!i.isValid()) || i.parent().isValid() || i.model() != modelAdapter()->rawModel())
+        return {};
 
-    return {};
+    return QRectF(
+        0.0, s_ptr->rowPosition(i.row()), d_ptr->m_UsedRect.width(), s_ptr->m_Extents.extent(i.row())
+    );
+}
+
+/**
+ * The RowExtents offsets are relative to the first row, but the positions
+ * are relative to the loaded elements. Above the loaded elements, use the
+ * first one. Otherwise use the end of the last one.
+ */
+QPair<int, qreal> ViewportSync::extentAnchor(bool above) const
+{
+    const auto first = m_pReflector->firstItem();
+    const auto last  = m_pReflector->lastItem ();
+
+    if ((!first) || (!last) || !(first->metadata()->isValid() && last->metadata()->isValid()))
+        return {0, q_ptr->modelAdapter()->view()->originY()};
+
+    if (above)
+        return {first->effectiveRow(), first->metadata()->decoratedGeometry().y()};
+
+    return {
+        m_pReflector->root()->lastChild()->effectiveRow() + 1,
+        last->metadata()->decoratedGeometry().bottom()
+    };
+}
+
+qreal ViewportSync::rowPosition(int row) const
+{
+    const auto first = m_pReflector->firstItem();
+    const auto a     = extentAnchor(first && row < first->effectiveRow());
+
+    // Skip the RowExtents, it is the same as long as the delegates are uniform
+    if (const qreal h = uniformHeight())
+        return a.second + (row - a.first) * h;
+
+    return a.second + m_Extents.offset(row) - m_Extents.offset(a.first);
+}
+
+int ViewportSync::rowAt(qreal y) const
+{
+    const auto first = m_pReflector->firstItem();
+    const bool above = first && first->metadata()->isValid()
+        && y < first->metadata()->decoratedGeometry().bottom();
+
+    const auto a = extentAnchor(above);
+
+    if (const qreal h = uniformHeight()) {
+        const int rc = m_Extents.rowCount();
+
+        if (!rc)
+            return -1;
+
+        return std::min(rc - 1, std::max(0,
+            a.first + static_cast<int>(std::floor((y - a.second) / h))
+        ));
+    }
+
+    return m_Extents.rowAt(m_Extents.offset(a.first) + y - a.second);
+}
+
+QPair<qreal, qreal> ViewportSync::contentEdges() const
+{
+    const auto first = m_pReflector->firstItem();
+
+    // rowPosition(0) would be relative to the bottom of the loaded elements
+    const qreal top = first && first->effectiveRow() == 0 && first->metadata()->isValid() ?
+        first->metadata()->decoratedGeometry().y() : rowPosition(0);
+
+    return {top, rowPosition(m_Extents.rowCount())};
+}
+
+qreal ViewportSync::uniformHeight() const
+{
+    static constexpr const int caps = GeometryAdapter::Capabilities::HAS_UNIFORM_HEIGHT
+        | GeometryAdapter::Capabilities::ALWAYS_HAS_SIZE_HINTS;
+
+    if ((m_pGeoAdapter->capabilities() & caps) != caps)
+        return 0;
+
+    return m_pGeoAdapter->sizeHint({}, nullptr).height();
 }
 
 #include <viewport.moc>
@@ -76,6 +76,7 @@ public:
     qint64      m_StartTime  {   0   };
     int         m_LastDelta  {   0   };
     qreal       m_Velocity   {   0   };
+    qreal       m_OriginY    {   0   };
     qreal       m_DecelRate  {  0.9  };
     bool        m_Interactive{ true  };
 
@@ -189,10 +190,10 @@ void Flickable::setContentY(qreal y)
         return;
 
     // Do not allow out of bound scroll
-    y = std::fmax(y, 0);
+    y = std::fmax(y, d_ptr->m_OriginY);
 
     if (d_ptr->m_pContainer->height() >= height())
-        y = std::fmin(y, d_ptr->m_pContainer->height() - height());
+        y = std::fmin(y, d_ptr->m_OriginY + d_ptr->m_pContainer->height() - height());
 
     if (d_ptr->m_pContainer->y() == -y)
         return;
@@ -202,10 +203,25 @@ void Flickable::setContentY(qreal y)
     emit contentYChanged(y);
     emit viewportChanged(viewport());
     emit percentageChanged(
-        ((-d_ptr->m_pContainer->y()))/(d_ptr->m_pContainer->height()-height())
+        (y - d_ptr->m_OriginY)/(d_ptr->m_pContainer->height()-height())
     );
 }
 
+qreal Flickable::originY() const
+{
+    return d_ptr->m_OriginY;
+}
+
+void Flickable::setOriginY(qreal y)
+{
+    if (y == d_ptr->m_OriginY)
+        return;
+
+    d_ptr->m_OriginY = y;
+
+    emit originYChanged(y);
+}
+
 qreal Flickable::contentHeight() const
 {
     if (!d_ptr->m_pContainer)
@@ -517,6 +533,13 @@ void Flickable::setMaximumFlickVelocity(qreal v)
     d_ptr->m_MaxVelocity = v;
 }
 
+qreal Flickable::verticalVelocity() const
+{
+    // The inertia moves the content up, so it is the opposite of the contentY
+    return d_ptr->m_State == FlickablePrivate::DragState::INERTIA ?
+        -d_ptr->m_Velocity : 0;
+}
+
 QQmlContext* Flickable::rootContext() const
 {
     if (!d_ptr->m_pRootContext)
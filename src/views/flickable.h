@@ -43,6 +43,7 @@ public:
     // Implement some of the QtQuick2.Flickable API
     Q_PROPERTY(qreal contentY READ contentY WRITE setContentY NOTIFY contentYChanged)
     Q_PROPERTY(qreal contentHeight READ contentHeight NOTIFY contentHeightChanged )
+    Q_PROPERTY(qreal originY READ originY NOTIFY originYChanged)
     Q_PROPERTY(bool dragging READ isDragging NOTIFY draggingChanged)
     Q_PROPERTY(bool flicking READ isDragging NOTIFY movingChanged)
     Q_PROPERTY(bool moving READ isDragging NOTIFY movingChanged)
@@ -70,6 +71,17 @@ public:
 
     qreal contentHeight() const;
 
+    /**
+     * The content coordinate of the top of the content.
+     *
+     * Like QtQuick.ListView, the content can grow upward. When elements are
+     * inserted above the viewport, they are placed above the existing ones
+     * and the origin moves up. This way, the visible elements (and contentY)
+     * stay where they are instead of all being moved down.
+     */
+    qreal originY() const;
+    void setOriginY(qreal y);
+
     QQuickItem* contentItem();
 
     bool isDragging() const;
@@ -84,11 +96,20 @@ public:
     qreal maximumFlickVelocity() const;
     void setMaximumFlickVelocity(qreal v);
 
+    /**
+     * The current inertia (in points per frame).
+     *
+     * It is positive when the content scrolls toward the end and 0 when
+     * there is no inertia.
+     */
+    qreal verticalVelocity() const;
+
     QQmlContext* rootContext() const;
 
 Q_SIGNALS:
     void contentHeightChanged(qreal height);
     void contentYChanged(qreal y);
+    void originYChanged(qreal y);
     void percentageChanged(qreal percent);
     void draggingChanged(bool dragging);
     void movingChanged(bool dragging);
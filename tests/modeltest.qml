@@ -75,6 +75,7 @@ Kirigami.ApplicationWindow {
 
     ModelViewTester {
         id: treeTester
+        view: listview
     }
 
 //     ListModelTester {
@@ -20,8 +20,12 @@
 #include <QtCore/QDebug>
 #include <QMetaObject>
 #include <QMetaMethod>
+#include <QQuickItem>
 
-#include <functional>
+#include <algorithm>
+
+#include <KQuickItemViews/singlemodelviewbase.h>
+#include <KQuickItemViews/adapters/modeladapter.h>
 
 #define DO(slot) steps << QString(#slot) ;
 
@@ -75,6 +79,35 @@ ModelViewTester::ModelViewTester(QObject* parent) : QAbstractItemModel(parent)
     //TODO removeWithChildren
     DO(resetModel);
 
+    // Rows without a QPersistentModelIndex (below the viewport)
+    DO(lightweightRows);
+    DO(checkLoadedRows);
+    DO(insertAboveLightweight);
+    DO(checkLoadedRows);
+    DO(removeAboveLightweight);
+    DO(checkLoadedRows);
+    DO(moveOutOfWindow);
+    DO(checkLoadedRows);
+    DO(moveIntoWindow);
+    DO(checkLoadedRows);
+    DO(movePartlyLoaded);
+    DO(checkLoadedRows);
+    DO(movePartlyLoadedToChild);
+    DO(movePartlyLoadedToRoot);
+    DO(checkLoadedRows);
+    DO(sortFirstRows);
+    DO(checkSortedRows);
+    DO(resetModel);
+    DO(lightweightTree);
+    DO(scrollToChildren);
+    DO(insertAboveLightweight);
+    DO(checkLightweightParent);
+    DO(removeAboveLightweight);
+    DO(checkLightweightParent);
+    DO(scrollToTop);
+    DO(persistentRows);
+    DO(resetModel);
+
     // Larger tree
     DO(largeFrontTree);
     DO(removeLargeTree);
@@ -521,3 +554,309 @@ void ModelViewTester::largeFrontTree2()
         endInsertRows();
     }
 }
+
+static void setIndexTrackingMode(QObject *view, ModelAdapter::IndexTrackingMode mode)
+{
+    if (auto v = qobject_cast<ViewBase*>(view)) {
+        const auto adapters = v->modelAdapters();
+        for (auto a : adapters)
+            a->setIndexTrackingMode(mode);
+    }
+}
+
+// Load more rows than the view can display
+void ModelViewTester::lightweightRows()
+{
+    setIndexTrackingMode(m_pView, ModelAdapter::IndexTrackingMode::LightweightIndices);
+
+    beginInsertRows({}, 0, 99);
+
+    for (int i = 0; i < 100; i++) {
+        QHash<int, QVariant> vals = {
+            {Qt::DisplayRole, "light root "+QString::number(i)},
+            {Qt::UserRole, 0}
+        };
+
+        new ModelViewTesterItem(m_pRoot, vals);
+    }
+
+    endInsertRows();
+}
+
+// The rows below have to be shifted by the view, the model doesn't know them
+void ModelViewTester::insertAboveLightweight()
+{
+    beginInsertRows({}, 0, 2);
+
+    for (int i = 2; i >= 0; i--) {
+        QHash<int, QVariant> vals = {
+            {Qt::DisplayRole, "inserted light root "+QString::number(i)},
+            {Qt::UserRole, 0}
+        };
+
+        new ModelViewTesterItem(m_pRoot, vals, 0);
+    }
+
+    endInsertRows();
+}
+
+void ModelViewTester::removeAboveLightweight()
+{
+    beginRemoveRows({}, 0, 1);
+
+    for (int i = 0; i < 2; i++) {
+        delete m_pRoot->m_lChildren[0];
+        m_pRoot->m_lChildren.remove(0);
+    }
+
+    for (int i = 0; i < m_pRoot->m_lChildren.size(); i++)
+        m_pRoot->m_lChildren[i]->m_Index = i;
+
+    endRemoveRows();
+}
+
+/**
+ * Move the rows like QAbstractItemModel::beginMoveRows expects them, the
+ * destination is in the coordinates from before the move.
+ */
+void ModelViewTester::moveItems(ModelViewTesterItem *from, int first, int last, ModelViewTesterItem *to, int destination)
+{
+    const auto fromIdx = from == m_pRoot ?
+        QModelIndex() : createIndex(from->m_Index, 0, from);
+    const auto toIdx = to == m_pRoot ?
+        QModelIndex() : createIndex(to->m_Index, 0, to);
+
+    const bool ret = beginMoveRows(fromIdx, first, last, toIdx, destination);
+    Q_ASSERT(ret);
+    Q_UNUSED(ret)
+
+    const auto elems = from->m_lChildren.mid(first, last - first + 1);
+    from->m_lChildren.remove(first, elems.size());
+
+    if (from == to && destination > last)
+        destination -= elems.size();
+
+    for (int i = 0; i < elems.size(); i++) {
+        elems[i]->m_pParent = to;
+        to->m_lChildren.insert(destination + i, elems[i]);
+    }
+
+    for (int i = 0; i < from->m_lChildren.size(); i++)
+        from->m_lChildren[i]->m_Index = i;
+
+    for (int i = 0; i < to->m_lChildren.size(); i++)
+        to->m_lChildren[i]->m_Index = i;
+
+    endMoveRows();
+}
+
+// Move a loaded row past the end of the loaded rows
+void ModelViewTester::moveOutOfWindow()
+{
+    moveItems(m_pRoot, 1, 1, m_pRoot, m_pRoot->m_lChildren.size() - 5);
+}
+
+// Move a row which isn't loaded above the loaded rows
+void ModelViewTester::moveIntoWindow()
+{
+    const int last = m_pRoot->m_lChildren.size() - 3;
+    moveItems(m_pRoot, last, last, m_pRoot, 1);
+}
+
+// Move a range where only the first rows are loaded to the end
+void ModelViewTester::movePartlyLoaded()
+{
+    moveItems(m_pRoot, 5, 70, m_pRoot, m_pRoot->m_lChildren.size());
+}
+
+// Same, but into another parent
+void ModelViewTester::movePartlyLoadedToChild()
+{
+    moveItems(m_pRoot, 2, 60, m_pRoot->m_lChildren[0], 0);
+}
+
+// And back to the top level, in front of the parent
+void ModelViewTester::movePartlyLoadedToRoot()
+{
+    auto par = m_pRoot->m_lChildren[0];
+    moveItems(par, 0, par->m_lChildren.size() - 1, m_pRoot, 0);
+}
+
+/**
+ * Walk the loaded top level rows from the top of the viewport (past the
+ * buffered ones) and check they are in the model order.
+ *
+ * If the rows of the elements without a QPersistentModelIndex were not
+ * shifted, they would no longer follow the visible elements.
+ */
+void ModelViewTester::forEachLoadedRow(const std::function<void(int row, QQuickItem *delegate)> &f)
+{
+    auto v = qobject_cast<SingleModelViewBase*>(m_pView);
+
+    if (!v)
+        return;
+
+    const auto top = v->topLeft();
+
+    if (!top.isValid())
+        return;
+
+    Q_ASSERT(!top.parent().isValid());
+
+    const QRectF rect = v->itemRect(top);
+    Q_ASSERT(rect.height() > 0);
+
+    const qreal bottom = rect.y() + v->height() * 2;
+    int row = top.row();
+
+    for (qreal y = rect.center().y(); y < bottom && row < rowCount(); y += rect.height()) {
+        const auto idx = v->indexAt(QPoint(0, y));
+
+        Q_ASSERT(idx.isValid());
+        Q_ASSERT(!idx.parent().isValid());
+        Q_ASSERT(idx.row() == row);
+
+        // The buffered elements are hidden, so there is no delegate
+        f(row, v->contentItem()->childAt(1, y));
+
+        row++;
+    }
+}
+
+void ModelViewTester::checkLoadedRows()
+{
+    forEachLoadedRow([](int, QQuickItem*) {});
+}
+
+// Sort the first rows in reverse order, they stay in the loaded rows
+void ModelViewTester::sortFirstRows()
+{
+    m_lDelegates.clear();
+
+    forEachLoadedRow([this](int, QQuickItem *delegate) {
+        m_lDelegates << delegate;
+    });
+
+    Q_EMIT layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+
+    const auto before = persistentIndexList();
+
+    auto &children = m_pRoot->m_lChildren;
+    std::reverse(children.begin(), children.begin() + std::min(10, children.size()));
+
+    for (int i = 0; i < children.size(); i++)
+        children[i]->m_Index = i;
+
+    QModelIndexList after;
+
+    for (const auto &idx : qAsConst(before)) {
+        auto item = static_cast<ModelViewTesterItem*>(idx.internalPointer());
+        after << createIndex(item->m_Index, idx.column(), item);
+    }
+
+    changePersistentIndexList(before, after);
+
+    Q_EMIT layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
+/**
+ * The rows are in the new order and the delegates were moved rather than
+ * recreated.
+ */
+void ModelViewTester::checkSortedRows()
+{
+    forEachLoadedRow([this](int, QQuickItem *delegate) {
+        if (!delegate)
+            return;
+
+        const bool found = std::any_of(m_lDelegates.constBegin(), m_lDelegates.constEnd(),
+            [delegate](const QPointer<QQuickItem> &d) { return d.data() == delegate; }
+        );
+
+        Q_ASSERT(found);
+        Q_UNUSED(found)
+    });
+
+    m_lDelegates.clear();
+}
+
+// A parent with more children than the view can display
+void ModelViewTester::lightweightTree()
+{
+    beginInsertRows({}, 0, 2);
+
+    for (int i = 0; i < 3; i++) {
+        QHash<int, QVariant> vals = {
+            {Qt::DisplayRole, "light tree "+QString::number(i)},
+            {Qt::UserRole, 0}
+        };
+
+        new ModelViewTesterItem(m_pRoot, vals);
+    }
+
+    endInsertRows();
+
+    auto parent = m_pRoot->m_lChildren[1];
+
+    beginInsertRows(createIndex(1, 0, parent), 0, 199);
+
+    for (int i = 0; i < 200; i++) {
+        QHash<int, QVariant> vals = {
+            {Qt::DisplayRole, "light child "+QString::number(i)},
+            {Qt::UserRole, 0}
+        };
+
+        new ModelViewTesterItem(parent, vals);
+    }
+
+    endInsertRows();
+}
+
+// Unload the first children, their parent stays, without a persistent index
+void ModelViewTester::scrollToChildren()
+{
+    auto v = qobject_cast<SingleModelViewBase*>(m_pView);
+
+    if (!v)
+        return;
+
+    const QRectF rect = v->itemRect(index(1, 0));
+
+    v->setProperty("contentY", rect.y() + rect.height() * 150);
+}
+
+void ModelViewTester::scrollToTop()
+{
+    if (m_pView)
+        m_pView->setProperty("contentY", 0);
+}
+
+/**
+ * The parent of the top element is above the viewport. If its row was not
+ * shifted, it could no longer be found.
+ */
+void ModelViewTester::checkLightweightParent()
+{
+    auto v = qobject_cast<SingleModelViewBase*>(m_pView);
+
+    if (!v)
+        return;
+
+    const auto top = v->topLeft();
+
+    if (!top.isValid())
+        return;
+
+    const auto parent = top.parent();
+    Q_ASSERT(parent.isValid());
+
+    const QRectF rect = v->itemRect(parent);
+    Q_ASSERT(rect.height() > 0);
+
+    Q_ASSERT(v->indexAt(rect.center().toPoint()) == parent);
+}
+
+void ModelViewTester::persistentRows()
+{
+    setIndexTrackingMode(m_pView, ModelAdapter::IndexTrackingMode::PersistentIndices);
+}
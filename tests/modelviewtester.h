@@ -17,8 +17,12 @@
  **************************************************************************/
 
 #include <QAbstractItemModel>
+#include <QPointer>
 #include <QTimer>
 
+#include <functional>
+
+class QQuickItem;
 struct ModelViewTesterItem;
 
 /**
@@ -34,6 +38,8 @@ Q_OBJECT
 
 public:
     Q_PROPERTY(int interval READ interval WRITE setInterval)
+    /// The view displaying this model, some steps check what it loaded
+    Q_PROPERTY(QObject* view READ view WRITE setView)
 
 
     explicit ModelViewTester(QObject* parent = nullptr);
@@ -44,6 +50,9 @@ public:
     int interval() const {return m_pTimer->interval(); }
     void setInterval(int i) { m_pTimer->setInterval(i); }
 
+    QObject *view() const { return m_pView; }
+    void setView(QObject *v) { m_pView = v; }
+
     //Model implementation
     virtual bool          setData      ( const QModelIndex& index, const QVariant &value, int role   ) override;
     virtual QVariant      data         ( const QModelIndex& index, int role = Qt::DisplayRole        ) const override;
@@ -74,6 +83,23 @@ public Q_SLOTS:
     void removeRoot();
     void resetModel();
 
+    void lightweightRows();
+    void insertAboveLightweight();
+    void removeAboveLightweight();
+    void moveOutOfWindow();
+    void moveIntoWindow();
+    void movePartlyLoaded();
+    void movePartlyLoadedToChild();
+    void movePartlyLoadedToRoot();
+    void sortFirstRows();
+    void checkSortedRows();
+    void checkLoadedRows();
+    void lightweightTree();
+    void scrollToChildren();
+    void checkLightweightParent();
+    void scrollToTop();
+    void persistentRows();
+
     void largeFrontTree();
     void removeLargeTree();
     void removeLargeTree2();
@@ -81,9 +107,14 @@ public Q_SLOTS:
     void removeLargeTree3();
 
 private:
+    void moveItems(ModelViewTesterItem *from, int first, int last, ModelViewTesterItem *to, int destination);
+    void forEachLoadedRow(const std::function<void(int row, QQuickItem *delegate)> &f);
+
     ModelViewTesterItem* m_pRoot;
 
     int count {0};
     QStringList steps;
     QTimer *m_pTimer {new QTimer(this)};
+    QPointer<QObject> m_pView;
+    QVector< QPointer<QQuickItem> > m_lDelegates;
 };
@@ -0,0 +1,151 @@
+/***************************************************************************
+ *   Copyright (C) 2019 by Emmanuel Lepage Vallee                          *
+ *   Author : Emmanuel Lepage Vallee <emmanuel.lepage@kde.org>             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+// Qt
+#include <QtTest/QtTest>
+
+// KQuickItemViews
+#include <statetracker/slab_p.h>
+
+/**
+ * Compare the slab used for the loaded rows (see ContentPrivate::m_Items)
+ * with one heap allocation per row.
+ *
+ * The rows are walked as a linked list, like refreshVisible or the edge
+ * updates do.
+ */
+class SlabBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void allocationCount();
+    void allocateSlab();
+    void allocateHeap();
+    void walkSlab();
+    void walkHeap();
+
+private:
+    /// About the size of a ModelItem
+    struct Row {
+        Row   *m_pNext {nullptr};
+        qreal  m_Height {  20.0 };
+        char   m_Padding[240];
+    };
+
+    static constexpr const int ROW_COUNT = 1000000;
+};
+
+constexpr const int SlabBenchmark::ROW_COUNT;
+
+void SlabBenchmark::allocationCount()
+{
+    StateTracker::Slab<Row> s;
+
+    for (int i = 0; i < ROW_COUNT; i++)
+        s.create();
+
+    // One allocation per chunk of 256 rows instead of one per row
+    QCOMPARE(s.size(), ROW_COUNT);
+    QCOMPARE(s.allocationCount(), (ROW_COUNT + 255) / 256);
+    QCOMPARE(s.capacity(), s.allocationCount() * 256);
+
+    qDebug() << "Allocations for" << ROW_COUNT << "rows:" << s.allocationCount();
+}
+
+void SlabBenchmark::allocateSlab()
+{
+    QVector<Row*> rows(ROW_COUNT);
+
+    QBENCHMARK {
+        StateTracker::Slab<Row> s;
+
+        for (int i = 0; i < ROW_COUNT; i++)
+            rows[i] = s.create();
+
+        for (int i = 0; i < ROW_COUNT; i++)
+            s.destroy(rows[i]);
+
+        QVERIFY(s.release());
+    }
+}
+
+void SlabBenchmark::allocateHeap()
+{
+    QVector<Row*> rows(ROW_COUNT);
+
+    QBENCHMARK {
+        for (int i = 0; i < ROW_COUNT; i++)
+            rows[i] = new Row;
+
+        for (int i = 0; i < ROW_COUNT; i++)
+            delete rows[i];
+    }
+}
+
+void SlabBenchmark::walkSlab()
+{
+    StateTracker::Slab<Row> s;
+
+    Row *first = s.create(), *prev = first;
+
+    for (int i = 1; i < ROW_COUNT; i++)
+        prev = prev->m_pNext = s.create();
+
+    qreal total = 0;
+
+    QBENCHMARK {
+        total = 0;
+
+        for (auto r = first; r; r = r->m_pNext)
+            total += r->m_Height;
+    }
+
+    QCOMPARE(total, ROW_COUNT * 20.0);
+}
+
+void SlabBenchmark::walkHeap()
+{
+    QVector<Row*> rows;
+    rows.reserve(ROW_COUNT);
+
+    Row *first = new Row, *prev = first;
+    rows << first;
+
+    for (int i = 1; i < ROW_COUNT; i++) {
+        prev = prev->m_pNext = new Row;
+        rows << prev;
+    }
+
+    qreal total = 0;
+
+    QBENCHMARK {
+        total = 0;
+
+        for (auto r = first; r; r = r->m_pNext)
+            total += r->m_Height;
+    }
+
+    QCOMPARE(total, ROW_COUNT * 20.0);
+
+    qDeleteAll(rows);
+}
+
+QTEST_MAIN(SlabBenchmark)
+
+#include "slabbenchmark.moc"